@@ -1,26 +1,76 @@
 #include "application.h"
 #include "SDL.h"
 #include "console.h"
+#include "control/utils.h"
+#include "control/jobSystem.h"
+#include "control/profiler.h"
+#include "control/logger.h"
+#include "inputRecorder.h"
+#include "render/renderer.h"
 #include <thread>
+#include <chrono>
+#include <mutex>
+#include <fstream>
+#include <deque>
 
 
 
 namespace sp {
 
 	Display* Application::_display = nullptr;
-	float Application::_accumulatedTime = 0.0f;
-	float Application::_currentTime = 0.0f;
-	float Application::_lastTime = 0.0f;
-	int Application::_frameRate = 60;
+	uint64_t Application::_accumulatedTime = 0;
+	uint64_t Application::_lastTime = 0;
+	uint64_t Application::_nextFrameTime = 0;
+	float Application::_frameTime = 0.0f;
+	float Application::_fixedTimeStep = 1.0f / 60.0f;
+	int Application::_maxFixedSteps = 8;
+	int Application::_frameRate = 0;
+	std::atomic<int> Application::_fastUpdateRate{ 120 };
+	std::atomic<ApplicationLayer*> Application::_fastLayer{ nullptr };
+
+	//held while fastUpdate runs so a layer switch never exits a layer mid tick
+	static std::mutex s_fastUpdateLock;
+
+	//tasks queued for the render thread by runOnMainThread / LoadContext::upload
+	static std::mutex s_mainThreadLock;
+	static std::deque<std::function<void()>> s_mainThreadTasks;
+	static JobHandle s_loadJob;
+
+	//times renderLoop on the gpu, dynamic resolution falls back to it when pass timing is off
+	static GpuTimer* s_gpuFrameTimer = nullptr;
+
+	//frames longer than this are treated as a stall (debugger, window drag) and clamped
+	const uint64_t cnst_max_frame_time_ns = 250000000;
 	ApplicationLayer* Application::_currentLayer = nullptr;
 	ApplicationLayer* Application::_overlayLayer = nullptr;
 	std::vector<ApplicationLayer*> Application::_application_layers = {};
+	uint Application::_frameCount = 0;
+	uint Application::_frameLimit = 0;
+	bool Application::_recordFrameTimings = false;
+	std::vector<float> Application::_frameTimings = {};
+	ApplicationLayer* Application::_pendingLayer = nullptr;
+	LoadContext* Application::_loadContext = nullptr;
+	float Application::_uploadBudget = 0.004f;
+
+
+	void LoadContext::upload(std::function<void()> task)
+	{
+		_pendingUploads++;
+		Application::runOnMainThread([this, task]() {
+			task();
+			_pendingUploads--;
+		});
+	}
 	
-	void Application::create(int width, int height, const char* title)
+	void Application::create(int width, int height, const char* title, DisplayMode mode)
 	{
-
+		Logger::init();
 		//create display
-		_display = new Display(width, height, title);
+		_display = new Display(width, height, title, mode);
+		s_gpuFrameTimer = new GpuTimer();
+		if (_display->isHeadless())
+			_recordFrameTimings = true;
+		JobSystem::init();
 		
 	}
 
@@ -33,26 +83,85 @@ namespace sp {
 			(*it)->onInit();
 		}
 		if (_currentLayer != nullptr)
-			_currentLayer->onLoad();
+			loadLayer(_currentLayer);
+
+		_lastTime = Clock::now_ns();
+		_nextFrameTime = _lastTime;
+		_accumulatedTime = 0;
 		
+		_fastLayer = _currentLayer;
+		Profiler::setThreadName("main");
 		std::thread t([]() {
+			Profiler::setThreadName("fast_update");
+			uint64_t last = Clock::now_ns();
+			uint64_t next = last;
 			while (!EventSystem::shouldQuit())
 			{
-				Application::fastLoop();
+				int rate = _fastUpdateRate;
+				if (rate <= 0)
+				{
+					//disabled, idle without burning a core
+					std::this_thread::sleep_for(std::chrono::milliseconds(50));
+					last = Clock::now_ns();
+					next = last;
+					continue;
+				}
+				uint64_t now = Clock::now_ns();
+				Application::fastLoop(float(Clock::toSeconds(now - last)));
+				last = now;
+				uint64_t period = 1000000000ull / rate;
+				next += period;
+				if (next + period < now)
+					next = now;
+				Clock::sleepUntil(next);
 			}
 		});
 		while (!EventSystem::shouldQuit())
 		{
+			sp_profile_scope("frame");
 			EventSystem::resetControlWord();
-			EventSystem::pollFromWindow(_display);
+			if (InputRecorder::isReplaying())
+			{
+				std::vector<RawInputEvent> events;
+				if (InputRecorder::nextReplayFrame(events))
+					EventSystem::injectEvents(events);
+				else
+				{
+					//recording ran out, the session is over
+					EventSystem::requestQuit();
+					break;
+				}
+			}
+			else if (!_display->isHeadless())
+				EventSystem::pollFromWindow(_display);
 			EventSystem::resolve();
+			runMainThreadTasks(true);
+			updateAsyncLoad();
 			if (_currentLayer != nullptr) {
 				loop();
 				renderLoop();
 			}
-			_display->onUpdate();
+			{
+				sp_profile_scope("Display::onUpdate");
+				_display->onUpdate();
+			}
+			_frameCount++;
+			if (_recordFrameTimings)
+				_frameTimings.push_back(_frameTime * 1000.0f);
+			if (_frameLimit > 0 && _frameCount >= _frameLimit)
+				EventSystem::requestQuit();
+			waitForNextFrame();
 		}
 		t.join();
+		//let an unfinished load settle so no worker touches a cleaned layer
+		if (_pendingLayer != nullptr)
+		{
+			JobSystem::wait(s_loadJob);
+			runMainThreadTasks(false);
+			delete _loadContext;
+			_loadContext = nullptr;
+			_pendingLayer = nullptr;
+		}
 		for (auto it = _application_layers.begin(); it != _application_layers.end(); it++)
 		{
 			(*it)->clean();
@@ -61,6 +170,11 @@ namespace sp {
 
 	void Application::close()
 	{
+		if (_display == nullptr || _display->isHeadless())
+		{
+			EventSystem::requestQuit();
+			return;
+		}
 		SDL_Event sdlevent;
 		sdlevent.type = SDL_QUIT;
 		SDL_PushEvent(&sdlevent);
@@ -73,8 +187,13 @@ namespace sp {
 		{
 			delete (*it);
 		}
+		InputRecorder::stopRecording();
+		JobSystem::shutdown();
+		delete s_gpuFrameTimer;
+		s_gpuFrameTimer = nullptr;
 		if (_display)
 			delete _display;
+		Logger::shutdown();
 	}
 
 	void Application::resizeWindow(int width, int height)
@@ -112,7 +231,7 @@ namespace sp {
 			}
 		}
 		_overlayLayer->onInit();
-		_overlayLayer->onLoad();
+		loadLayer(_overlayLayer);
 	}
 
 	void Application::popOverlayLayer()
@@ -124,44 +243,215 @@ namespace sp {
 
 	void Application::switchLayer(std::string name)
 	{
+		ApplicationLayer* layer = findLayer(name);
+		if (layer == nullptr)
+		{
+			Logger::warn(LogCategory::app, "switchLayer: no layer named {}", name);
+			return;
+		}
+		if (_pendingLayer != nullptr)
+		{
+			Logger::warn(LogCategory::app, "switchLayer: cannot switch layer while {} is loading", _pendingLayer->getName());
+			return;
+		}
+		std::lock_guard<std::mutex> guard(s_fastUpdateLock);
 		_currentLayer->onExit();
+		_currentLayer = layer;
+		loadLayer(_currentLayer);
+		_fastLayer = _currentLayer;
+	}
+
+	void Application::switchLayerAsync(std::string name, std::string loadingLayer)
+	{
+		ApplicationLayer* layer = findLayer(name);
+		if (layer == nullptr)
+		{
+			Logger::warn(LogCategory::app, "switchLayerAsync: no layer named {}", name);
+			return;
+		}
+		if (_pendingLayer != nullptr)
+		{
+			Logger::warn(LogCategory::app, "switchLayerAsync: cannot switch layer while {} is loading", _pendingLayer->getName());
+			return;
+		}
+		if (loadingLayer != "" && loadingLayer != _currentLayer->getName())
+			switchLayer(loadingLayer);
+
+		_pendingLayer = layer;
+		_loadContext = new LoadContext();
+		LoadContext* context = _loadContext;
+		s_loadJob = JobSystem::submit([layer, context]() {
+			layer->onLoadAsync(*context);
+		});
+	}
+
+	void Application::runOnMainThread(std::function<void()> task)
+	{
+		std::lock_guard<std::mutex> guard(s_mainThreadLock);
+		s_mainThreadTasks.push_back(std::move(task));
+	}
+
+	ApplicationLayer* Application::findLayer(std::string name)
+	{
 		for (auto it = _application_layers.begin(); it != _application_layers.end(); it++)
 		{
-			if ((*it)->getName() == name) {
-				_currentLayer = *it;
+			if ((*it)->getName() == name)
+				return *it;
+		}
+		return nullptr;
+	}
+
+	void Application::loadLayer(ApplicationLayer* layer)
+	{
+		//synchronous path, same callbacks as the async one
+		LoadContext context;
+		layer->onLoadAsync(context);
+		while (context.hasPendingUploads())
+			runMainThreadTasks(false);
+		layer->onLoad();
+	}
+
+	void Application::runMainThreadTasks(bool budgeted)
+	{
+		sp_profile_function();
+		uint64_t deadline = Clock::now_ns() + Clock::fromSeconds(_uploadBudget);
+		bool first = true;
+		while (true)
+		{
+			//always run one task, otherwise a single slow upload would never fit the budget
+			if (budgeted && !first && Clock::now_ns() >= deadline)
+				break;
+			std::function<void()> task;
+			{
+				std::lock_guard<std::mutex> guard(s_mainThreadLock);
+				if (s_mainThreadTasks.empty())
+					break;
+				task = std::move(s_mainThreadTasks.front());
+				s_mainThreadTasks.pop_front();
 			}
+			task();
+			first = false;
 		}
+	}
+
+	void Application::updateAsyncLoad()
+	{
+		if (_pendingLayer == nullptr || !s_loadJob.isDone() || _loadContext->hasPendingUploads())
+			return;
+		ApplicationLayer* layer = _pendingLayer;
+		_pendingLayer = nullptr;
+		delete _loadContext;
+		_loadContext = nullptr;
+		s_loadJob = JobHandle();
+
+		std::lock_guard<std::mutex> guard(s_fastUpdateLock);
+		_currentLayer->onExit();
+		_currentLayer = layer;
 		_currentLayer->onLoad();
+		_fastLayer = _currentLayer;
 	}
 
-	void Application::fastLoop() {
-		if(_currentLayer != nullptr)
-		_currentLayer->fastUpdate(_accumulatedTime / 1000);
+	void Application::fastLoop(float dt) {
+		sp_profile_function();
+		std::lock_guard<std::mutex> guard(s_fastUpdateLock);
+		ApplicationLayer* layer = _fastLayer;
+		if(layer != nullptr)
+		layer->fastUpdate(dt);
 	}
 
 
 	void Application::loop()
 	{
+		sp_profile_function();
 		//time calculation
-		_currentTime = SDL_GetTicks();
-		_accumulatedTime = _currentTime - _lastTime;
-		_lastTime = _currentTime;
+		uint64_t currentTime = Clock::now_ns();
+		uint64_t elapsed = currentTime - _lastTime;
+		_lastTime = currentTime;
+		if (elapsed > cnst_max_frame_time_ns)
+			elapsed = cnst_max_frame_time_ns;
+		if (InputRecorder::isReplaying())
+			elapsed = InputRecorder::getReplayFrameTime();
+		InputRecorder::commitFrame(elapsed);
+		_frameTime = float(Clock::toSeconds(elapsed));
+
+		_currentLayer->onFrameStart();
+		if (_overlayLayer != nullptr)
+			_overlayLayer->onFrameStart();
+
+		//fixed step simulation
+		uint64_t step = Clock::fromSeconds(_fixedTimeStep);
+		if (step > 0)
+		{
+			sp_profile_scope("Application::fixedUpdate");
+			_accumulatedTime += elapsed;
+			int steps = 0;
+			while (_accumulatedTime >= step && steps < _maxFixedSteps)
+			{
+				_currentLayer->appFixedUpdate(_fixedTimeStep);
+				if (_overlayLayer != nullptr)
+					_overlayLayer->appFixedUpdate(_fixedTimeStep);
+				_accumulatedTime -= step;
+				steps++;
+			}
+			//could not keep up, drop the backlog instead of stalling further
+			if (_accumulatedTime >= step)
+				_accumulatedTime %= step;
+
+			float alpha = float(double(_accumulatedTime) / double(step));
+			_currentLayer->setInterpolationAlpha(alpha);
+			if (_overlayLayer != nullptr)
+				_overlayLayer->setInterpolationAlpha(alpha);
+		}
 
 		//update and render all application layers
-		_currentLayer->appUpdate(_accumulatedTime/1000);
+		_currentLayer->appUpdate(_frameTime);
 		if (_overlayLayer != nullptr) {
-			_overlayLayer->appUpdate(_accumulatedTime / 1000);
+			_overlayLayer->appUpdate(_frameTime);
 			}
 
 	}
+
+	bool Application::dumpFrameTimings(std::string path)
+	{
+		std::ofstream file(path);
+		if (!file.is_open())
+			return false;
+		file << "frame,ms\n";
+		for (size_t i = 0; i < _frameTimings.size(); i++)
+			file << i << "," << _frameTimings[i] << "\n";
+		return true;
+	}
+
+	void Application::waitForNextFrame()
+	{
+		if (_frameRate <= 0)
+			return;
+		uint64_t period = 1000000000ull / _frameRate;
+		uint64_t now = Clock::now_ns();
+		_nextFrameTime += period;
+		//fell more than a frame behind, resync instead of bursting to catch up
+		if (_nextFrameTime + period < now)
+			_nextFrameTime = now;
+		sp_profile_scope("Application::frameLimiter");
+		Clock::sleepUntil(_nextFrameTime);
+	}
 	void Application::renderLoop()
 	{
+		sp_profile_function();
+		s_gpuFrameTimer->begin();
 		//clear renderer
+		_display->bindScreenTarget();
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 		_currentLayer->onRender();
 		if (_overlayLayer != nullptr) {
 			_overlayLayer->onRender();
 		}
+		s_gpuFrameTimer->end();
+	}
+
+	float Application::getGpuFrameTime_ms()
+	{
+		return s_gpuFrameTimer ? s_gpuFrameTimer->getTime_ms() : 0.0f;
 	}
 
 }
@@ -3,54 +3,118 @@
 #include "display.h"
 #include "deps/glad.h"
 #include "eventSystem.h"
+#include "control/tripleBuffer.h"
 #include <string>
+#include <cstdint>
+#include <atomic>
+#include <functional>
 
 
 namespace sp {
 
+	//handed to ApplicationLayer::onLoadAsync, reports progress and queues gl work back to the render thread
+	class SP_API LoadContext
+	{
+	private:
+		std::atomic<float> _progress{ 0.0f };
+		std::atomic<int> _pendingUploads{ 0 };
+	public:
+		void setProgress(float progress) { _progress = progress; } // 0 to 1
+		float getProgress() const { return _progress; }
+		void upload(std::function<void()> task); // runs on the render thread within the upload budget
+		bool hasPendingUploads() const { return _pendingUploads > 0; }
+	};
+
 	//base class for application layer
 	// must be implemented(inherited) with two methods:
 	// init(), update(float dt);
+	// simulation that needs a stable step goes in onFixedUpdate(), which runs at Application::getFixedTimeStep()
+	// slow loading goes in onLoadAsync(), it runs on a worker thread, anything touching opengl must go through LoadContext::upload()
+	// (RenderModelLoader::decode_file / upload_decoded and TextCreator::decodeFont / submitFont are split that way)
 	class SP_API ApplicationLayer
 	{
 	private:
 		float _dt; //time in second
+		float _alpha = 0.0f; // fraction of a fixed step left in the accumulator
 		std::string _name;
 	public:
 		ApplicationLayer(std::string name) { _name = name; };
 		virtual ~ApplicationLayer() {};
 		virtual void onInit() = 0;
-		virtual void onLoad() {};
+		virtual void onLoadAsync(LoadContext& context) {}; // worker thread, before onLoad
+		virtual void onLoad() {}; // render thread, once all uploads of onLoadAsync are done
 		virtual void onExit() {};
 		virtual void onUpdate(float dt) = 0; // time in second
-		virtual void fastUpdate(float dt) {}; // runs on different thread. // used variables must be deadlock protected
+		virtual void onFixedUpdate(float dt) {}; // called zero or more times per frame with the fixed step
+		virtual void onFrameStart() {}; // called on the render thread before any update of the frame
+		virtual void fastUpdate(float dt) {}; // runs on different thread at Application::getFastUpdateRate(). // used variables must be deadlock protected, read input through an InputSubscriber
 		virtual void clean() {};
 		void appUpdate(float dt)
 		{
 			onUpdate(dt);
 			_dt = dt;
 		}
+		void appFixedUpdate(float dt) { onFixedUpdate(dt); }
+		void setInterpolationAlpha(float alpha) { _alpha = alpha; }
 		
 		virtual void onRender() {};
 		float getDeltaTime_s() const { return _dt; }
 		float getDeltaTime_ms() const { return _dt * 1000; }
+		float getInterpolationAlpha() const { return _alpha; } // blend factor between last two fixed updates, use in onRender
 		std::string getName() const { return _name; }
 
 	};
 
+	//layer whose simulation runs on the fastUpdate thread and hands finished states to the render thread
+	//implement onSimulate() for the fast thread and read getSnapshot() in onUpdate/onRender
+	//the snapshot is latched once per frame, so the whole frame sees one consistent state without locks
+	template<typename State>
+	class SnapshotLayer : public ApplicationLayer
+	{
+	private:
+		State _simState; // owned by the fast thread
+		TripleBuffer<State> _snapshots;
+	public:
+		SnapshotLayer(std::string name, const State& initial = State())
+			: ApplicationLayer(name), _simState(initial), _snapshots(initial) {}
+
+		virtual void onSimulate(State& state, float dt) = 0; // runs on the fastUpdate thread
+
+		void fastUpdate(float dt) override
+		{
+			onSimulate(_simState, dt);
+			_snapshots.publish(_simState);
+		}
+		void onFrameStart() override { _snapshots.acquire(); }
+
+		const State& getSnapshot() const { return _snapshots.read(); }
+	};
+
 	class SP_API Application
 	{
 	private:
 		static Display* _display;
-		static float _accumulatedTime;
-		static float _currentTime;
-		static float _lastTime;
-		static int _frameRate;
+		static uint64_t _accumulatedTime; // ns not yet consumed by fixed updates
+		static uint64_t _lastTime; // ns
+		static uint64_t _nextFrameTime; // ns, deadline used by the frame limiter
+		static float _frameTime; // seconds, duration of the last frame
+		static float _fixedTimeStep; // seconds
+		static int _maxFixedSteps;
+		static int _frameRate; // 0 means uncapped
+		static std::atomic<int> _fastUpdateRate; // hz of the background fastUpdate thread
+		static std::atomic<ApplicationLayer*> _fastLayer; // layer seen by the fastUpdate thread
 		static ApplicationLayer* _currentLayer;
 		static ApplicationLayer* _overlayLayer;
 		static std::vector<ApplicationLayer*> _application_layers;
+		static uint _frameCount;
+		static uint _frameLimit; // 0 means run until closed
+		static bool _recordFrameTimings;
+		static std::vector<float> _frameTimings; // ms
+		static ApplicationLayer* _pendingLayer; // layer being loaded by switchLayerAsync
+		static LoadContext* _loadContext;
+		static float _uploadBudget; // seconds of main thread tasks per frame
 	public:
-		static void create(int width = 640, int height = 480, const char* title = "application");
+		static void create(int width = 640, int height = 480, const char* title = "application", DisplayMode mode = DisplayMode::window);
 		static void run();
 		static void close();
 		static void destroy();
@@ -59,20 +123,43 @@ namespace sp {
 		static void pushLayer(ApplicationLayer* layer);
 		static void pushOverlayLayer(std::string name);
 		static void popOverlayLayer();
-		static void switchLayer(std::string name);
+		static void switchLayer(std::string name); // blocks until the layer is loaded
+		//loads the layer on worker threads, current layer (or loadingLayer if given) keeps running until it is ready
+		static void switchLayerAsync(std::string name, std::string loadingLayer = "");
+		static void runOnMainThread(std::function<void()> task); // thread safe, runs at the start of a frame
 
 		static int getWidth() { return _display->getWidth(); }
 		static int getHeight() { return _display->getHeight(); }
 		static int getFrameRate() { return _frameRate; }
+		static float getFrameTime() { return _frameTime; }
+		static float getFixedTimeStep() { return _fixedTimeStep; }
+		static int getFastUpdateRate() { return _fastUpdateRate; }
+		static uint getFrameCount() { return _frameCount; }
+		static const std::vector<float>& getFrameTimings() { return _frameTimings; }
+		static bool dumpFrameTimings(std::string path); // csv of frame index and frame time in ms
 		static Display* getMainDisplay() { return _display; }
+		static float getGpuFrameTime_ms(); // gpu time of the whole render loop, a few frames old
+		static bool isLoading() { return _pendingLayer != nullptr; }
+		static float getLoadProgress() { return _loadContext ? _loadContext->getProgress() : 1.0f; }
 
 
-		static void setFrameRate(int frameRate) { _frameRate = frameRate; }
+		static void setFrameRate(int frameRate) { _frameRate = frameRate; } // 0 disables the limiter
+		static void setFixedTimeStep(float seconds) { _fixedTimeStep = seconds; }
+		static void setMaxFixedSteps(int steps) { _maxFixedSteps = steps; } // cap per frame, avoids spiral of death
+		static void setFastUpdateRate(int hz) { _fastUpdateRate = hz; } // 0 pauses fastUpdate
+		static void setFrameLimit(uint frames) { _frameLimit = frames; } // run() returns after this many frames, useful headless
+		static void setRecordFrameTimings(bool record) { _recordFrameTimings = record; }
+		static void setUploadBudget_ms(float ms) { _uploadBudget = ms / 1000.0f; } // at least one task always runs per frame
 
-		static void fastLoop();
+		static void fastLoop(float dt);
 	private:
 		static void renderLoop();
 		static void loop();
+		static void waitForNextFrame();
+		static ApplicationLayer* findLayer(std::string name);
+		static void loadLayer(ApplicationLayer* layer);
+		static void runMainThreadTasks(bool budgeted);
+		static void updateAsyncLoad();
 
 
 	};
@@ -3,6 +3,7 @@
 #include <iomanip>
 #include <conio.h>
 #include "deps/glad.h"
+#include "control/logger.h"
 #include <boost/stacktrace.hpp>
 #include <SDL.h>
 
@@ -27,70 +28,48 @@ namespace sp {
 
 	void Console::vec4(glm::vec4 v)
 	{
-		std::cout << "( " << v.x << ", " << v.y << ", " << v.z << ", " << v.w << " )" << std::endl;
+		Logger::info(LogCategory::general, "( {}, {}, {}, {} )", v.x, v.y, v.z, v.w);
 	}
 	void Console::vec3(glm::vec3 v)
 	{
-		std::cout << "( " << v.x << ", " << v.y << ", " << v.z << " )" << std::endl;
+		Logger::info(LogCategory::general, "( {}, {}, {} )", v.x, v.y, v.z);
 	}
 	void Console::mat4(glm::mat4 m)
 	{
-		setConsoleColor(ConsoleColorType::forground_green);
 		for (int y = 0; y < 4; y++)
 		{
-			for (int x = 0; x < 4; x++)
-			{
-				std::cout << std::setw(6) << std::setprecision(4) << m[y][x];
-			}
-			std::cout << std::endl;
+			Logger::info(LogCategory::general, "{} {} {} {}", m[y][0], m[y][1], m[y][2], m[y][3]);
 		}
-		setConsoleColor(ConsoleColorType::forground_white);
 	}
 	void Console::str(std::string s)
 	{
-		std::cout << s << std::endl;
+		Logger::info(LogCategory::general, "{}", s);
 	}
 	void Console::label(std::string s, float f)
 	{
-		setConsoleColor(ConsoleColorType::forground_yellow);
-		std::cout << s << std::endl;
-		setConsoleColor(ConsoleColorType::forground_white);
-		Console::real(f);
+		Logger::info(LogCategory::general, "{} : {}", s, f);
 	}
 	void Console::label(std::string s, glm::vec3 v)
 	{
-		setConsoleColor(ConsoleColorType::forground_yellow);
-		std::cout << s << std::endl;
-		setConsoleColor(ConsoleColorType::forground_white);
-		Console::vec3(v);
+		Logger::info(LogCategory::general, "{} : ( {}, {}, {} )", s, v.x, v.y, v.z);
 	}
 	void Console::label(std::string s, glm::vec4 v)
 	{
-		setConsoleColor(ConsoleColorType::forground_yellow);
-		std::cout << s << std::endl;
-		setConsoleColor(ConsoleColorType::forground_white);
-		Console::vec4(v);
+		Logger::info(LogCategory::general, "{} : ( {}, {}, {}, {} )", s, v.x, v.y, v.z, v.w);
 	}
 	void Console::label(std::string s, glm::mat4 m)
 	{
-		setConsoleColor(ConsoleColorType::forground_yellow);
-		std::cout << s << std::endl;
-		setConsoleColor(ConsoleColorType::forground_white);
+		Logger::info(LogCategory::general, "{}", s);
 		Console::mat4(m);
 	}
 	void Console::err(std::string s, std::string trace)
 	{
-		setConsoleColor(ConsoleColorType::forground_yellow);
-		std::cout << "err : ";
-		setConsoleColor(ConsoleColorType::forground_red);
-		std::cout << s << std::endl;
+		//shader and link logs end up here, keep all of them
+		Logger::logText(LogLevel::error, LogCategory::general, "err : ", s);
 		if (trace != "")
-		{
-			setConsoleColor(ConsoleColorType::forground_yellow);
-			std::cout << "trace : ";
-			setConsoleColor(ConsoleColorType::forground_red);
-			std::cout << trace << std::endl;
-		}
+			Logger::logText(LogLevel::error, LogCategory::general, "trace : ", trace);
+		//fatal, everything queued must be out before we exit
+		Logger::shutdown();
 		setConsoleColor(ConsoleColorType::forground_yellow);
 		std::cout << "stack trace : " << std::endl;
 		setConsoleColor(ConsoleColorType::forground_red);
@@ -104,11 +83,11 @@ namespace sp {
 	
 	void Console::real(float f)
 	{
-		std::cout << f << std::endl;
+		Logger::info(LogCategory::general, "{}", f);
 	}
 	void Console::real(unsigned int u)
 	{
-		std::cout << u << std::endl;
+		Logger::info(LogCategory::general, "{}", u);
 	}
 	void Console::v_vec3(std::vector<glm::vec3>& v)
 	{
@@ -119,31 +98,21 @@ namespace sp {
 	}
 	void Console::gl_debug(unsigned int type, const char * message)
 	{
-		std::string t = "";
 		if (type == GL_DEBUG_TYPE_ERROR && _log_filter > 0)
 		{
-			t = "error";
+			Logger::logText(LogLevel::error, LogCategory::gl, "opengl debug ( error ): ", message);
 		}
 		else if (type == GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR && _log_filter > 0)
 		{
-			t = "undefined behavior";
+			Logger::logText(LogLevel::warning, LogCategory::gl, "opengl debug ( undefined behavior ): ", message);
 		}
 		else if (type == GL_DEBUG_TYPE_PERFORMANCE && _log_filter > 1)
 		{
-			t = "performance";
+			Logger::logText(LogLevel::warning, LogCategory::gl, "opengl debug ( performance ): ", message);
 		}
 		else if (type == GL_DEBUG_TYPE_OTHER && _log_filter > 2)
 		{
-			t = "debug other";
-		}
-		if (t != "") {
-			setConsoleColor(ConsoleColorType::forground_yellow);
-			std::cout << "opengl debug: " << "( " << t << " )" << std::endl;
-			setConsoleColor(ConsoleColorType::forground_green);
-			std::cout << "message:" << std::endl;
-			setConsoleColor(ConsoleColorType::forground_white);
-			std::cout << message << std::endl;
-
+			Logger::logText(LogLevel::info, LogCategory::gl, "opengl debug ( debug other ): ", message);
 		}
 	}
 
@@ -1,5 +1,6 @@
 #include "camera.h"
 #include "../deps/glm/gtc/matrix_transform.hpp"
+#include "../eventSystem.h"
 #include <iostream>
 namespace sp{
 
@@ -10,7 +11,8 @@ namespace sp{
 		_speed(speed),
 		_sencitivity_x(0.005),
 		_sencitivity_y(0.003),
-		_projection_matrix(projectionMatrix)
+		_projection_matrix(projectionMatrix),
+		_late_latch(false)
 	{
 
 		_transform.setCallback(sp_convert_transfrom_callback(Camera::calculateMatrices));
@@ -61,7 +63,27 @@ namespace sp{
 
 	void Camera::rotateCam(float x, float y)
 	{
-		_transform.rotate(x * (_invert_x? 1.0f : -1.0f) * _sencitivity_x, y * (_invert_y? 1.0f : -1.0f) * _sencitivity_y);
+		glm::vec2 angles = mouseToAngles(x, y);
+		_transform.rotate(angles.x, angles.y);
+	}
+
+	void Camera::lateLatch()
+	{
+		_latched_view_matrix = _view_matrix;
+		float dx, dy;
+		if (!_late_latch || !EventSystem::peekMouseMotion(dx, dy))
+			return;
+		//predict on a detached copy, the callback would overwrite our view matrix
+		Transform predicted = _transform;
+		predicted.setCallback(nullptr);
+		glm::vec2 angles = mouseToAngles(dx, dy);
+		predicted.rotate(angles.x, angles.y);
+		_latched_view_matrix = glm::lookAt(predicted.getPosition(), predicted.getPosition() + predicted.getDirectionFront(), predicted.getDirectionUp());
+	}
+
+	glm::vec2 Camera::mouseToAngles(float x, float y) const
+	{
+		return glm::vec2(x * (_invert_x? 1.0f : -1.0f) * _sencitivity_x, y * (_invert_y? 1.0f : -1.0f) * _sencitivity_y);
 	}
 
 	glm::mat4 Camera::genPerspectiveProjectionMatrix(float fov, int width, int height, float near, float far)
@@ -86,6 +108,7 @@ namespace sp{
 	void Camera::calculateMatrices()
 	{
 		_view_matrix = glm::lookAt(_transform.getPosition(), _transform.getPosition() + _transform.getDirectionFront(), _transform.getDirectionUp());
+		_latched_view_matrix = _view_matrix;
 	}
 
 };
\ No newline at end of file
@@ -23,6 +23,8 @@ namespace sp {
 		float _sencitivity_y;
 		glm::mat4 _view_matrix;
 		glm::mat4 _projection_matrix;
+		glm::mat4 _latched_view_matrix;
+		bool _late_latch;
 
 
 	public:
@@ -43,6 +45,14 @@ namespace sp {
 		//rotate camera
 		void rotateCam(float x, float y);
 
+		//late latch: right before drawing, re-derive the view with mouse motion that arrived after input was polled
+		//assumes mouse look goes through rotateCam(Mouse.dx, Mouse.dy), the transform itself is not changed
+		//(that motion is applied for real next frame), so nothing is counted twice
+		void setLateLatch(bool enable) { _late_latch = enable; }
+		bool isLateLatched() const { return _late_latch; }
+		void lateLatch();
+		glm::mat4 getRenderViewMatrix() const { return _late_latch ? _latched_view_matrix : _view_matrix; } // view to draw with
+
 		//generate projection matrix
 		static glm::mat4 genPerspectiveProjectionMatrix(float fov = cnst_default_cam_angle, int width = 640, int height = 480, float near = 0.01f, float far = 400.0f);
 		static glm::mat4 genOrthoProjectionMatrix(float left, float right, float top, float bottom, float near = 10.0f, float far = -100.0f);
@@ -69,6 +79,7 @@ namespace sp {
 		void setProjectionMatrix(glm::mat4 mat) { _projection_matrix = mat; }
 	private:
 		virtual void calculateMatrices();
+		glm::vec2 mouseToAngles(float x, float y) const;
 	};
 	
 
@@ -0,0 +1,345 @@
+#include "jobSystem.h"
+#include "../console.h"
+#include "profiler.h"
+#include <atomic>
+#include <cstdlib>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace sp {
+
+	//shared state of a job, alive as long as a handle or a queue references it
+	struct JobState
+	{
+		std::function<void()> fn;
+		std::atomic<int> unfinished{ 1 }; // itself + children
+		std::atomic<int> pendingDependencies{ 1 };
+		std::atomic<bool> done{ false };
+		std::mutex lock; // guards continuations
+		std::vector<std::shared_ptr<JobState>> continuations;
+		std::shared_ptr<JobState> parent;
+	};
+
+	struct WorkQueue
+	{
+		std::mutex lock;
+		std::deque<std::shared_ptr<JobState>> jobs;
+	};
+
+	static std::vector<std::unique_ptr<WorkQueue>> s_queues; // one per worker + injection queue at the end
+	static std::vector<std::thread> s_threads;
+	static std::atomic<bool> s_running{ false };
+	static std::atomic<int> s_pending{ 0 };
+	static std::atomic<int> s_sleeping{ 0 };
+	static std::mutex s_sleepLock;
+	static std::condition_variable s_wake;
+	static thread_local int t_workerIndex = -1;
+
+
+	bool JobHandle::isDone() const
+	{
+		return !_state || _state->done.load(std::memory_order_acquire);
+	}
+
+	void JobHandle::wait() const
+	{
+		JobSystem::wait(*this);
+	}
+
+
+	//exit() without shutdown() (every Console::err) would destroy joinable std::threads and terminate,
+	//registered by init() so it runs before the statics above are destroyed
+	static void stopWorkersAtExit()
+	{
+		if (!s_running)
+			return;
+		{
+			std::lock_guard<std::mutex> guard(s_sleepLock);
+			s_running = false;
+		}
+		s_wake.notify_all();
+		for (auto& t : s_threads)
+		{
+			if (t.get_id() == std::this_thread::get_id())
+				t.detach(); // exit() was called from a job
+			else
+				t.join();
+		}
+		s_threads.clear();
+	}
+
+	void JobSystem::init(uint threadCount)
+	{
+		if (s_running)
+			return;
+		static bool s_exitHook = false;
+		if (!s_exitHook)
+		{
+			std::atexit(stopWorkersAtExit);
+			s_exitHook = true;
+		}
+		if (threadCount == 0)
+		{
+			uint hw = std::thread::hardware_concurrency();
+			threadCount = hw > 1 ? hw - 1 : 1;
+		}
+		for (uint i = 0; i <= threadCount; i++)
+			s_queues.push_back(std::unique_ptr<WorkQueue>(new WorkQueue()));
+		s_running = true;
+		for (uint i = 0; i < threadCount; i++)
+			s_threads.push_back(std::thread(workerMain, i));
+	}
+
+	void JobSystem::shutdown()
+	{
+		if (!s_running)
+			return;
+		//drain what is left so no handle is left waiting forever
+		while (runOne()) {}
+		{
+			std::lock_guard<std::mutex> guard(s_sleepLock);
+			s_running = false;
+		}
+		s_wake.notify_all();
+		for (auto& t : s_threads)
+			t.join();
+		s_threads.clear();
+		s_queues.clear();
+		s_pending = 0;
+	}
+
+	JobHandle JobSystem::submit(std::function<void()> job)
+	{
+		std::shared_ptr<JobState> state = std::make_shared<JobState>();
+		state->fn = std::move(job);
+		schedule(state);
+		return JobHandle(state);
+	}
+
+	JobHandle JobSystem::submit(std::function<void()> job, const std::vector<JobHandle>& dependencies)
+	{
+		std::shared_ptr<JobState> state = std::make_shared<JobState>();
+		state->fn = std::move(job);
+		state->pendingDependencies = (int)dependencies.size() + 1;
+		for (const JobHandle& dep : dependencies)
+		{
+			std::shared_ptr<JobState> d = dep.getState();
+			bool ready = true;
+			if (d)
+			{
+				std::lock_guard<std::mutex> guard(d->lock);
+				if (!d->done)
+				{
+					d->continuations.push_back(state);
+					ready = false;
+				}
+			}
+			if (ready)
+				state->pendingDependencies.fetch_sub(1);
+		}
+		if (state->pendingDependencies.fetch_sub(1) == 1)
+			schedule(state);
+		return JobHandle(state);
+	}
+
+	JobHandle JobSystem::parallelForAsync(uint begin, uint end, uint grain, std::function<void(uint, uint)> fn)
+	{
+		std::shared_ptr<JobState> group = std::make_shared<JobState>();
+		if (end <= begin)
+		{
+			group->done = true;
+			return JobHandle(group);
+		}
+		uint count = end - begin;
+		if (grain == 0)
+		{
+			grain = count / ((getThreadCount() + 1) * 4);
+			if (grain == 0) grain = 1;
+		}
+		uint chunks = (count + grain - 1) / grain;
+		group->unfinished = (int)chunks;
+
+		auto shared_fn = std::make_shared<std::function<void(uint, uint)>>(std::move(fn));
+		for (uint c = 0; c < chunks; c++)
+		{
+			uint b = begin + c * grain;
+			uint e = b + grain < end ? b + grain : end;
+			std::shared_ptr<JobState> state = std::make_shared<JobState>();
+			state->fn = [shared_fn, b, e]() { (*shared_fn)(b, e); };
+			state->parent = group;
+			schedule(state);
+		}
+		return JobHandle(group);
+	}
+
+	void JobSystem::parallelFor(uint begin, uint end, uint grain, std::function<void(uint, uint)> fn)
+	{
+		wait(parallelForAsync(begin, end, grain, std::move(fn)));
+	}
+
+	void JobSystem::wait(const JobHandle& handle)
+	{
+		while (!handle.isDone())
+		{
+			if (!runOne())
+				std::this_thread::yield();
+		}
+	}
+
+	void JobSystem::waitAll(const std::vector<JobHandle>& handles)
+	{
+		for (const JobHandle& h : handles)
+			wait(h);
+	}
+
+	uint JobSystem::getThreadCount()
+	{
+		return (uint)s_threads.size();
+	}
+
+	bool JobSystem::isInitialized()
+	{
+		return s_running;
+	}
+
+	void JobSystem::schedule(std::shared_ptr<JobState> state)
+	{
+		if (!s_running)
+		{
+			//no pool, run inline
+			if (state->fn)
+				state->fn();
+			finish(state);
+			return;
+		}
+		uint index = t_workerIndex >= 0 ? (uint)t_workerIndex : (uint)s_queues.size() - 1;
+		{
+			std::lock_guard<std::mutex> guard(s_queues[index]->lock);
+			s_queues[index]->jobs.push_back(std::move(state));
+		}
+		s_pending.fetch_add(1);
+		if (s_sleeping.load() > 0)
+		{
+			{ std::lock_guard<std::mutex> guard(s_sleepLock); }
+			s_wake.notify_one();
+		}
+	}
+
+	void JobSystem::finish(std::shared_ptr<JobState> state)
+	{
+		if (state->unfinished.fetch_sub(1) != 1)
+			return;
+		std::vector<std::shared_ptr<JobState>> continuations;
+		{
+			std::lock_guard<std::mutex> guard(state->lock);
+			state->done.store(true, std::memory_order_release);
+			continuations.swap(state->continuations);
+		}
+		state->fn = nullptr; // release captures early
+		for (auto& c : continuations)
+		{
+			if (c->pendingDependencies.fetch_sub(1) == 1)
+				schedule(c);
+		}
+		if (state->parent)
+			finish(state->parent);
+	}
+
+	bool JobSystem::runOne()
+	{
+		if (s_queues.empty())
+			return false;
+		std::shared_ptr<JobState> job;
+		uint workers = (uint)s_queues.size() - 1;
+		uint self = t_workerIndex >= 0 ? (uint)t_workerIndex : workers;
+
+		//own queue, newest first
+		if (t_workerIndex >= 0)
+		{
+			std::lock_guard<std::mutex> guard(s_queues[self]->lock);
+			if (!s_queues[self]->jobs.empty())
+			{
+				job = std::move(s_queues[self]->jobs.back());
+				s_queues[self]->jobs.pop_back();
+			}
+		}
+		//injection queue, then steal oldest from the others
+		for (uint k = 0; !job && k <= workers; k++)
+		{
+			uint victim = (workers + self + k) % (workers + 1);
+			if (victim == self && t_workerIndex >= 0)
+				continue;
+			std::lock_guard<std::mutex> guard(s_queues[victim]->lock);
+			if (!s_queues[victim]->jobs.empty())
+			{
+				job = std::move(s_queues[victim]->jobs.front());
+				s_queues[victim]->jobs.pop_front();
+			}
+		}
+		if (!job)
+			return false;
+		s_pending.fetch_sub(1);
+		if (job->fn)
+		{
+			sp_profile_scope("job");
+			job->fn();
+		}
+		finish(job);
+		return true;
+	}
+
+	void JobSystem::workerMain(uint index)
+	{
+		t_workerIndex = (int)index;
+		Profiler::setThreadName("worker " + std::to_string(index));
+		while (s_running)
+		{
+			if (runOne())
+				continue;
+			std::unique_lock<std::mutex> guard(s_sleepLock);
+			s_sleeping.fetch_add(1);
+			s_wake.wait(guard, []() { return s_pending.load() > 0 || !s_running; });
+			s_sleeping.fetch_sub(1);
+		}
+	}
+
+
+	uint TaskGraph::addTask(std::function<void()> task, std::vector<uint> dependencies)
+	{
+		for (uint d : dependencies)
+		{
+			if (d >= _nodes.size())
+				Console::err("task graph dependency must be added before the task using it", "TaskGraph::addTask");
+		}
+		_nodes.push_back({ task, dependencies });
+		return (uint)_nodes.size() - 1;
+	}
+
+	JobHandle TaskGraph::run()
+	{
+		_handles.clear();
+		_handles.reserve(_nodes.size());
+		for (Node& node : _nodes)
+		{
+			std::vector<JobHandle> deps = {};
+			for (uint d : node.dependencies)
+				deps.push_back(_handles[d]);
+			_handles.push_back(JobSystem::submit(node.task, deps));
+		}
+		return JobSystem::submit([]() {}, _handles);
+	}
+
+	void TaskGraph::wait()
+	{
+		JobSystem::waitAll(_handles);
+	}
+
+	void TaskGraph::clear()
+	{
+		_nodes.clear();
+		_handles.clear();
+	}
+
+};
@@ -0,0 +1,79 @@
+#pragma once
+#include "../api.h"
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace sp {
+
+	struct JobState;
+
+	//handle to a submitted job or group of jobs
+	//default constructed handle is always complete
+	class SP_API JobHandle
+	{
+	private:
+		std::shared_ptr<JobState> _state;
+	public:
+		JobHandle() {}
+		JobHandle(std::shared_ptr<JobState> state) : _state(state) {}
+
+		bool isDone() const;
+		void wait() const; // runs other jobs while waiting
+		std::shared_ptr<JobState> getState() const { return _state; }
+	};
+
+	//engine owned work stealing thread pool
+	//each worker owns a deque, it pops its own work lifo and steals fifo from the others
+	//threads outside the pool submit to a shared injection queue
+	//if the pool is not initialized every call runs inline on the caller
+	class SP_API JobSystem
+	{
+	public:
+		static void init(uint threadCount = 0); // 0 = hardware threads - 1
+		static void shutdown();
+
+		static JobHandle submit(std::function<void()> job);
+		static JobHandle submit(std::function<void()> job, const std::vector<JobHandle>& dependencies); // starts after all dependencies complete
+
+		//splits [begin, end) into chunks of at most grain items, fn receives (chunk_begin, chunk_end)
+		static JobHandle parallelForAsync(uint begin, uint end, uint grain, std::function<void(uint, uint)> fn);
+		static void parallelFor(uint begin, uint end, uint grain, std::function<void(uint, uint)> fn); // blocks, caller helps
+
+		static void wait(const JobHandle& handle);
+		static void waitAll(const std::vector<JobHandle>& handles);
+
+		static uint getThreadCount();
+		static bool isInitialized();
+
+	private:
+		static void schedule(std::shared_ptr<JobState> state);
+		static void finish(std::shared_ptr<JobState> state);
+		static bool runOne();
+		static void workerMain(uint index);
+	};
+
+	//set of tasks with dependencies, built once and run as many times as needed
+	class SP_API TaskGraph
+	{
+	private:
+		struct Node
+		{
+			std::function<void()> task;
+			std::vector<uint> dependencies;
+		};
+		std::vector<Node> _nodes;
+		std::vector<JobHandle> _handles;
+
+	public:
+		TaskGraph() {}
+
+		uint addTask(std::function<void()> task, std::vector<uint> dependencies = {}); // dependencies are ids returned earlier
+		JobHandle run(); // returns a handle that completes when every task is done
+		void wait();
+		void clear();
+
+		uint getTaskCount() const { return (uint)_nodes.size(); }
+	};
+
+};
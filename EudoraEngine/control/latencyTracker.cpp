@@ -0,0 +1,162 @@
+#include "latencyTracker.h"
+#include "utils.h"
+#include "../deps/glad.h"
+#include <algorithm>
+#include <deque>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+
+namespace sp {
+
+	const size_t cnst_latency_max_pending_fences = 8;
+	const uint cnst_latency_histogram_buckets = 34; // 1 ms wide, last bucket collects everything above
+
+	struct PendingFrame
+	{
+		GLsync fence;
+		uint64_t input_ns; // 0 if the frame consumed no input
+		uint64_t present_ns;
+	};
+
+	static std::deque<PendingFrame> s_pending;
+	static uint64_t s_frameInput = 0; // oldest input of the frame being built
+	static uint64_t s_lastPresent = 0;
+
+	bool LatencyTracker::_enabled = false;
+	std::vector<float> LatencyTracker::_inputToResolve = {};
+	std::vector<float> LatencyTracker::_inputToPresent = {};
+	std::vector<float> LatencyTracker::_inputToGpu = {};
+	std::vector<float> LatencyTracker::_frameTimes = {};
+
+	static float toMs(uint64_t from, uint64_t to)
+	{
+		return to > from ? float(double(to - from) / 1000000.0) : 0.0f;
+	}
+
+	void LatencyTracker::setEnabled(bool enable)
+	{
+		if (!enable)
+			pollFences(true);
+		_enabled = enable;
+		s_frameInput = 0;
+		s_lastPresent = 0;
+	}
+
+	void LatencyTracker::clear()
+	{
+		_inputToResolve.clear();
+		_inputToPresent.clear();
+		_inputToGpu.clear();
+		_frameTimes.clear();
+	}
+
+	void LatencyTracker::recordInput(uint64_t time_ns)
+	{
+		if (!_enabled)
+			return;
+		if (s_frameInput == 0 || time_ns < s_frameInput)
+			s_frameInput = time_ns;
+	}
+
+	void LatencyTracker::markResolved()
+	{
+		if (!_enabled || s_frameInput == 0)
+			return;
+		_inputToResolve.push_back(toMs(s_frameInput, Clock::now_ns()));
+	}
+
+	void LatencyTracker::markPresent()
+	{
+		if (!_enabled)
+			return;
+		uint64_t now = Clock::now_ns();
+		if (s_lastPresent != 0)
+			_frameTimes.push_back(toMs(s_lastPresent, now));
+		s_lastPresent = now;
+		if (s_frameInput != 0)
+			_inputToPresent.push_back(toMs(s_frameInput, now));
+
+		pollFences(false);
+		if (s_pending.size() >= cnst_latency_max_pending_fences)
+		{
+			//gpu is far behind, give up on the oldest instead of piling up fences
+			glDeleteSync(s_pending.front().fence);
+			s_pending.pop_front();
+		}
+		s_pending.push_back({ glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), s_frameInput, now });
+		s_frameInput = 0;
+	}
+
+	void LatencyTracker::pollFences(bool flush)
+	{
+		while (!s_pending.empty())
+		{
+			PendingFrame& frame = s_pending.front();
+			GLenum state = glClientWaitSync(frame.fence, 0, 0);
+			if (state == GL_TIMEOUT_EXPIRED && !flush)
+				break;
+			if (state != GL_TIMEOUT_EXPIRED && state != GL_WAIT_FAILED && frame.input_ns != 0)
+				_inputToGpu.push_back(toMs(frame.input_ns, Clock::now_ns()));
+			glDeleteSync(frame.fence);
+			s_pending.pop_front();
+		}
+	}
+
+	float LatencyTracker::getPercentile(const std::vector<float>& samples, float percentile)
+	{
+		if (samples.empty())
+			return 0.0f;
+		std::vector<float> sorted = samples;
+		size_t index = size_t(percentile / 100.0f * (sorted.size() - 1) + 0.5f);
+		if (index >= sorted.size())
+			index = sorted.size() - 1;
+		std::nth_element(sorted.begin(), sorted.begin() + index, sorted.end());
+		return sorted[index];
+	}
+
+	std::string LatencyTracker::report()
+	{
+		std::ostringstream out;
+		out << std::fixed << std::setprecision(2);
+		auto line = [&out](const char* name, const std::vector<float>& samples) {
+			out << std::left << std::setw(16) << name
+				<< " samples " << std::setw(7) << samples.size()
+				<< " p50 " << std::setw(7) << getPercentile(samples, 50.0f)
+				<< " p95 " << std::setw(7) << getPercentile(samples, 95.0f)
+				<< " p99 " << std::setw(7) << getPercentile(samples, 99.0f) << " ms\n";
+		};
+		line("input->resolve", _inputToResolve);
+		line("input->present", _inputToPresent);
+		line("input->gpu done", _inputToGpu);
+		line("frame time", _frameTimes);
+
+		uint histogram[cnst_latency_histogram_buckets] = {};
+		uint peak = 0;
+		for (float ms : _frameTimes)
+		{
+			uint bucket = std::min(uint(ms), cnst_latency_histogram_buckets - 1);
+			histogram[bucket]++;
+			peak = std::max(peak, histogram[bucket]);
+		}
+		out << "frame time histogram (ms)\n";
+		for (uint b = 0; b < cnst_latency_histogram_buckets; b++)
+		{
+			if (histogram[b] == 0)
+				continue;
+			out << std::right << std::setw(3) << b << (b == cnst_latency_histogram_buckets - 1 ? "+ " : "  ") << "| "
+				<< std::string(std::max(size_t(1), size_t(40.0 * histogram[b] / peak + 0.5)), '#') << " " << histogram[b] << "\n";
+		}
+		return out.str();
+	}
+
+	bool LatencyTracker::dumpReport(std::string path)
+	{
+		std::ofstream file(path);
+		if (!file.is_open())
+			return false;
+		file << report();
+		return true;
+	}
+
+};
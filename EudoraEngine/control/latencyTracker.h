@@ -0,0 +1,43 @@
+#pragma once
+#include "../api.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace sp {
+
+	//measures input to photon latency and frame pacing
+	//input time is the sdl timestamp of the oldest event polled for a frame, the frame is then followed
+	//through EventSystem::resolve, the return of the swap and gpu completion (fence, observed once per frame)
+	//off by default, the hooks cost nothing until setEnabled(true)
+	class SP_API LatencyTracker
+	{
+	private:
+		static bool _enabled;
+		static std::vector<float> _inputToResolve; // ms
+		static std::vector<float> _inputToPresent; // ms, until swap returned
+		static std::vector<float> _inputToGpu; // ms, until the frame's fence was seen signaled
+		static std::vector<float> _frameTimes; // ms, present to present
+	public:
+		static void setEnabled(bool enable);
+		static bool isEnabled() { return _enabled; }
+		static void clear();
+
+		//hooks, main thread
+		static void recordInput(uint64_t time_ns); // EventSystem::pollFromWindow
+		static void markResolved(); // EventSystem::resolve
+		static void markPresent(); // Display::onUpdate, after the swap
+
+		static const std::vector<float>& getInputToPresent() { return _inputToPresent; }
+		static const std::vector<float>& getInputToGpu() { return _inputToGpu; }
+		static const std::vector<float>& getFrameTimes() { return _frameTimes; }
+		static float getPercentile(const std::vector<float>& samples, float percentile); // percentile in 0-100
+
+		static std::string report(); // p50/p95/p99 of every stage and a frame time histogram
+		static bool dumpReport(std::string path);
+
+	private:
+		static void pollFences(bool flush);
+	};
+
+};
@@ -0,0 +1,317 @@
+#include "logger.h"
+#include "utils.h"
+#include "../console.h"
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace sp {
+
+	const uint cnst_log_ring_size = 1024; // records per thread, power of two
+	const uint cnst_log_label_size = 48; // longest logText() label kept
+	const char* const cnst_log_level_names[] = { "trace", "info ", "warn ", "error" };
+	const char* const cnst_log_category_names[] = { "general", "render", "gl", "input", "app" };
+
+	//single producer (owning thread) single consumer (drain) ring
+	struct LogRing
+	{
+		uint32_t threadId = 0;
+		std::atomic<uint64_t> head{ 0 };
+		std::atomic<uint64_t> tail{ 0 };
+		std::atomic<uint64_t> dropped{ 0 };
+		LogRecord records[cnst_log_ring_size];
+	};
+
+	std::atomic<uint8_t> Logger::_level{ static_cast<uint8_t>(LogLevel::info) };
+	std::atomic<uint32_t> Logger::_categories{ ~0u };
+
+	static std::mutex s_ringLock; // thread registration and drain
+	static std::vector<std::unique_ptr<LogRing>> s_rings;
+	static thread_local LogRing* t_ring = nullptr;
+
+	static std::mutex s_drainLock; // one drain at a time, guards the sinks
+	static std::vector<LogRecord> s_batch;
+	static bool s_consoleSink = true;
+	static std::ofstream s_file;
+	static std::string s_filePath;
+	static uint s_fileMaxBytes = 0;
+	static uint s_fileMaxFiles = 0;
+	static uint64_t s_fileBytes = 0;
+	static uint64_t s_origin = Clock::now_ns(); // log times are relative to startup
+
+	static std::thread s_sink;
+	static std::mutex s_sinkLock;
+	static std::condition_variable s_wake;
+	static std::condition_variable s_flushed;
+	static std::atomic<bool> s_running{ false };
+	static uint64_t s_flushRequests = 0;
+	static uint64_t s_flushesDone = 0;
+
+	static LogRing* getThreadRing()
+	{
+		if (t_ring == nullptr)
+		{
+			std::lock_guard<std::mutex> guard(s_ringLock);
+			s_rings.push_back(std::unique_ptr<LogRing>(new LogRing()));
+			t_ring = s_rings.back().get();
+			t_ring->threadId = (uint32_t)s_rings.size();
+		}
+		return t_ring;
+	}
+
+	void Logger::init()
+	{
+		std::lock_guard<std::mutex> guard(s_sinkLock);
+		if (s_running)
+			return;
+		s_running = true;
+		s_sink = std::thread(sinkMain);
+	}
+
+	void Logger::shutdown()
+	{
+		{
+			std::lock_guard<std::mutex> guard(s_sinkLock);
+			if (!s_running)
+				return;
+			s_running = false;
+		}
+		s_wake.notify_all();
+		s_sink.join();
+		drain();
+		std::lock_guard<std::mutex> guard(s_drainLock);
+		if (s_file.is_open())
+			s_file.flush();
+	}
+
+	void Logger::flush()
+	{
+		std::unique_lock<std::mutex> lock(s_sinkLock);
+		if (!s_running)
+		{
+			lock.unlock();
+			drain();
+			return;
+		}
+		uint64_t target = ++s_flushRequests;
+		s_wake.notify_all();
+		s_flushed.wait(lock, [target]() { return s_flushesDone >= target || !s_running; });
+	}
+
+	void Logger::setCategoryEnabled(LogCategory category, bool enable)
+	{
+		uint32_t bit = 1u << static_cast<uint8_t>(category);
+		if (enable)
+			_categories.fetch_or(bit);
+		else
+			_categories.fetch_and(~bit);
+	}
+
+	void Logger::setFileSink(std::string path, uint max_bytes, uint max_files)
+	{
+		std::lock_guard<std::mutex> guard(s_drainLock);
+		if (s_file.is_open())
+			s_file.close();
+		s_filePath = path;
+		s_fileMaxBytes = max_bytes;
+		s_fileMaxFiles = max_files > 0 ? max_files : 1;
+		s_fileBytes = 0;
+		if (path != "")
+			s_file.open(path, std::ios::out | std::ios::trunc);
+	}
+
+	void Logger::setConsoleSink(bool enable)
+	{
+		std::lock_guard<std::mutex> guard(s_drainLock);
+		s_consoleSink = enable;
+	}
+
+	uint64_t Logger::getDroppedCount()
+	{
+		std::lock_guard<std::mutex> guard(s_ringLock);
+		uint64_t total = 0;
+		for (auto& ring : s_rings)
+			total += ring->dropped.load();
+		return total;
+	}
+
+	void Logger::logText(LogLevel level, LogCategory category, const char* label, const std::string& text)
+	{
+		if (!shouldLog(level, category))
+			return;
+		//room for the longest label and both terminators
+		const size_t room = cnst_log_text_size - cnst_log_label_size - 2;
+		std::string head(label, std::min(std::strlen(label), (size_t)cnst_log_label_size));
+		bool first = true;
+		size_t begin = 0;
+		do
+		{
+			size_t end = text.find('\n', begin);
+			if (end == std::string::npos)
+				end = text.size();
+			size_t length = std::min(end - begin, room);
+			std::string line = text.substr(begin, length);
+			if (!line.empty() && line.back() == '\r')
+				line.pop_back();
+			if (first || !line.empty())
+				log(level, category, "{}{}", first ? head : std::string(), line);
+			first = false;
+			begin += length;
+			if (begin == end)
+				begin++;
+		} while (begin < text.size());
+	}
+
+	LogRecord* Logger::beginRecord(LogLevel level, LogCategory category, const char* format)
+	{
+		LogRing* ring = getThreadRing();
+		uint64_t head = ring->head.load(std::memory_order_relaxed);
+		if (head - ring->tail.load(std::memory_order_acquire) >= cnst_log_ring_size)
+		{
+			ring->dropped.fetch_add(1, std::memory_order_relaxed);
+			return nullptr;
+		}
+		LogRecord* record = &ring->records[head & (cnst_log_ring_size - 1)];
+		record->time_ns = Clock::now_ns();
+		record->format = format;
+		record->level = level;
+		record->category = category;
+		record->arg_count = 0;
+		record->text_used = 0;
+		record->thread_id = ring->threadId;
+		return record;
+	}
+
+	void Logger::commitRecord()
+	{
+		LogRing* ring = t_ring;
+		ring->head.store(ring->head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+		//no sink thread, write it right away
+		if (!s_running)
+			drain();
+	}
+
+	static void formatRecord(const LogRecord& record, std::string& out)
+	{
+		char prefix[64];
+		std::snprintf(prefix, sizeof(prefix), "[%10.4f] %s %-7s ", double(record.time_ns - s_origin) / 1e9,
+			cnst_log_level_names[static_cast<uint8_t>(record.level)], cnst_log_category_names[static_cast<uint8_t>(record.category)]);
+		out = prefix;
+		uint next = 0;
+		for (const char* c = record.format; *c != '\0'; c++)
+		{
+			if (c[0] == '{' && c[1] == '}' && next < record.arg_count)
+			{
+				const LogArg& arg = record.args[next++];
+				switch (arg.type)
+				{
+				case LogArg::integer: out += std::to_string(arg.i); break;
+				case LogArg::unsigned_integer: out += std::to_string(arg.u); break;
+				case LogArg::real:
+				{
+					char number[32];
+					std::snprintf(number, sizeof(number), "%g", arg.d);
+					out += number;
+				}
+					break;
+				case LogArg::text: out += record.text + arg.offset; break;
+				}
+				c++;
+			}
+			else
+				out += *c;
+		}
+	}
+
+	static void rotateFile()
+	{
+		s_file.close();
+		//path.(n-2) -> path.(n-1) ... path -> path.1
+		for (int i = (int)s_fileMaxFiles - 1; i > 0; i--)
+		{
+			std::string from = i == 1 ? s_filePath : s_filePath + "." + std::to_string(i - 1);
+			std::string to = s_filePath + "." + std::to_string(i);
+			std::remove(to.c_str());
+			std::rename(from.c_str(), to.c_str());
+		}
+		s_file.open(s_filePath, std::ios::out | std::ios::trunc);
+		s_fileBytes = 0;
+	}
+
+	void Logger::drain()
+	{
+		std::lock_guard<std::mutex> drainGuard(s_drainLock);
+		s_batch.clear();
+		{
+			std::lock_guard<std::mutex> guard(s_ringLock);
+			for (auto& ring : s_rings)
+			{
+				uint64_t head = ring->head.load(std::memory_order_acquire);
+				uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+				for (; tail != head; tail++)
+					s_batch.push_back(ring->records[tail & (cnst_log_ring_size - 1)]);
+				ring->tail.store(tail, std::memory_order_release);
+			}
+		}
+		if (s_batch.empty())
+			return;
+		std::stable_sort(s_batch.begin(), s_batch.end(), [](const LogRecord& a, const LogRecord& b) { return a.time_ns < b.time_ns; });
+
+		std::string line;
+		for (const LogRecord& record : s_batch)
+		{
+			formatRecord(record, line);
+			if (s_consoleSink)
+			{
+				if (record.level == LogLevel::error)
+					Console::setConsoleColor(ConsoleColorType::forground_red);
+				else if (record.level == LogLevel::warning)
+					Console::setConsoleColor(ConsoleColorType::forground_yellow);
+				std::cout << line << '\n';
+				if (record.level >= LogLevel::warning)
+					Console::setConsoleColor(ConsoleColorType::forground_white);
+			}
+			if (s_file.is_open())
+			{
+				s_file << line << '\n';
+				s_fileBytes += line.size() + 1;
+				if (s_fileMaxBytes > 0 && s_fileBytes >= s_fileMaxBytes)
+					rotateFile();
+			}
+		}
+		if (s_consoleSink)
+			std::cout.flush();
+		if (s_file.is_open())
+			s_file.flush();
+	}
+
+	void Logger::sinkMain()
+	{
+		while (true)
+		{
+			uint64_t requests;
+			bool running;
+			{
+				std::unique_lock<std::mutex> lock(s_sinkLock);
+				s_wake.wait_for(lock, std::chrono::milliseconds(5), []() { return s_flushRequests != s_flushesDone || !s_running; });
+				requests = s_flushRequests;
+				running = s_running;
+			}
+			drain();
+			{
+				std::lock_guard<std::mutex> lock(s_sinkLock);
+				s_flushesDone = requests;
+			}
+			s_flushed.notify_all();
+			if (!running)
+				break;
+		}
+	}
+
+};
@@ -0,0 +1,162 @@
+#pragma once
+#include "../api.h"
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+namespace sp {
+
+	enum class LogLevel : uint8_t
+	{
+		trace = 0,
+		info,
+		warning,
+		error,
+	};
+
+	enum class LogCategory : uint8_t
+	{
+		general = 0,
+		render,
+		gl,
+		input,
+		app,
+		count,
+	};
+
+	const uint cnst_log_max_args = 6;
+	const uint cnst_log_text_size = 200; // bytes for copied string arguments, longer text is cut (logText() splits it)
+
+	//argument kept raw until the sink formats it
+	struct LogArg
+	{
+		enum Type : uint8_t { integer, unsigned_integer, real, text } type;
+		union
+		{
+			int64_t i;
+			uint64_t u;
+			double d;
+			uint32_t offset; // into LogRecord::text
+		};
+	};
+
+	//one log call, fixed size so rings never allocate
+	struct LogRecord
+	{
+		uint64_t time_ns;
+		const char* format; // string literal, "{}" is replaced by the next argument
+		LogLevel level;
+		LogCategory category;
+		uint8_t arg_count;
+		uint16_t text_used;
+		uint32_t thread_id;
+		LogArg args[cnst_log_max_args];
+		char text[cnst_log_text_size];
+	};
+
+	//asynchronous logger: every thread writes fixed size records into its own lock free ring,
+	//a sink thread formats them (time ordered) to the console and an optional rotating file
+	//a call that passes the filter copies a few words and never blocks, a full ring drops the record
+	//without init() (or after shutdown()) records are written synchronously
+	class SP_API Logger
+	{
+	private:
+		static std::atomic<uint8_t> _level;
+		static std::atomic<uint32_t> _categories; // bit per LogCategory
+	public:
+		static void init();
+		static void shutdown(); // flushes and stops the sink thread
+		static void flush(); // blocks until everything logged so far is written
+
+		static void setLevel(LogLevel level) { _level = static_cast<uint8_t>(level); }
+		static void setCategoryEnabled(LogCategory category, bool enable);
+		static bool shouldLog(LogLevel level, LogCategory category)
+		{
+			return static_cast<uint8_t>(level) >= _level.load(std::memory_order_relaxed)
+				&& (_categories.load(std::memory_order_relaxed) >> static_cast<uint8_t>(category)) & 1;
+		}
+		//rotates to path.1 ... path.<max_files - 1> once the file grows past max_bytes, empty path disables
+		static void setFileSink(std::string path, uint max_bytes = 4 << 20, uint max_files = 3);
+		static void setConsoleSink(bool enable);
+		static uint64_t getDroppedCount();
+
+		template<typename... Args>
+		static void log(LogLevel level, LogCategory category, const char* format, const Args&... args)
+		{
+			static_assert(sizeof...(Args) <= cnst_log_max_args, "too many log arguments");
+			if (!shouldLog(level, category))
+				return;
+			LogRecord* record = beginRecord(level, category, format);
+			if (record == nullptr)
+				return;
+			int expand[] = { 0, (packArg(*record, args), 0)... };
+			(void)expand;
+			commitRecord();
+		}
+		template<typename... Args>
+		static void trace(LogCategory category, const char* format, const Args&... args) { log(LogLevel::trace, category, format, args...); }
+		template<typename... Args>
+		static void info(LogCategory category, const char* format, const Args&... args) { log(LogLevel::info, category, format, args...); }
+		template<typename... Args>
+		static void warn(LogCategory category, const char* format, const Args&... args) { log(LogLevel::warning, category, format, args...); }
+		template<typename... Args>
+		static void error(LogCategory category, const char* format, const Args&... args) { log(LogLevel::error, category, format, args...); }
+		//for text of any length (shader logs, driver messages): one record per line, a line that does not fit
+		//in a record continues in the next one, label is written before the first line only
+		static void logText(LogLevel level, LogCategory category, const char* label, const std::string& text);
+
+	private:
+		static LogRecord* beginRecord(LogLevel level, LogCategory category, const char* format);
+		static void commitRecord();
+		static void drain();
+		static void sinkMain();
+
+		static void packText(LogRecord& record, const char* s, size_t length)
+		{
+			LogArg& arg = record.args[record.arg_count++];
+			arg.type = LogArg::text;
+			if (record.text_used >= cnst_log_text_size)
+			{
+				//no room left, the argument reads as the terminator of the previous one
+				arg.offset = cnst_log_text_size - 1;
+				record.text[cnst_log_text_size - 1] = '\0';
+				return;
+			}
+			arg.offset = record.text_used;
+			size_t room = cnst_log_text_size - record.text_used - 1;
+			if (length > room)
+				length = room;
+			std::memcpy(record.text + record.text_used, s, length);
+			record.text_used += (uint16_t)length;
+			record.text[record.text_used++] = '\0';
+		}
+		static void packArg(LogRecord& record, const char* s) { packText(record, s ? s : "(null)", s ? std::strlen(s) : 6); }
+		static void packArg(LogRecord& record, char* s) { packArg(record, (const char*)s); }
+		static void packArg(LogRecord& record, const std::string& s) { packText(record, s.c_str(), s.size()); }
+		template<size_t N>
+		static void packArg(LogRecord& record, const char(&s)[N]) { packArg(record, (const char*)s); }
+		template<typename T>
+		static typename std::enable_if<std::is_arithmetic<T>::value>::type packArg(LogRecord& record, const T& v)
+		{
+			LogArg& arg = record.args[record.arg_count++];
+			if (std::is_floating_point<T>::value)
+			{
+				arg.type = LogArg::real;
+				arg.d = (double)v;
+			}
+			else if (std::is_signed<T>::value)
+			{
+				arg.type = LogArg::integer;
+				arg.i = (int64_t)v;
+			}
+			else
+			{
+				arg.type = LogArg::unsigned_integer;
+				arg.u = (uint64_t)v;
+			}
+		}
+	};
+
+};
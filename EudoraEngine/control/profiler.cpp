@@ -0,0 +1,149 @@
+#include "profiler.h"
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace sp {
+
+	const uint cnst_profiler_ring_size = 1 << 16; // events per thread, power of two
+
+	//single producer (owning thread) single consumer (exporter) ring
+	struct ProfileRing
+	{
+		uint threadId = 0;
+		std::string threadName;
+		std::atomic<uint64_t> head{ 0 }; // written by owner
+		std::atomic<uint64_t> tail{ 0 }; // written by exporter
+		std::atomic<uint64_t> dropped{ 0 };
+		ProfileEvent events[cnst_profiler_ring_size];
+	};
+
+	std::atomic<bool> Profiler::_enabled{ false };
+
+	static std::mutex s_ringLock; // only taken when a thread registers or on export
+	static std::vector<std::unique_ptr<ProfileRing>> s_rings;
+	static thread_local ProfileRing* t_ring = nullptr;
+	static thread_local std::string t_threadName; // set before the thread's first zone, the ring does not exist yet
+
+	static ProfileRing* getThreadRing()
+	{
+		if (t_ring == nullptr)
+		{
+			std::lock_guard<std::mutex> guard(s_ringLock);
+			s_rings.push_back(std::unique_ptr<ProfileRing>(new ProfileRing()));
+			t_ring = s_rings.back().get();
+			t_ring->threadId = (uint)s_rings.size();
+			t_ring->threadName = t_threadName.empty() ? "thread " + std::to_string(t_ring->threadId) : t_threadName;
+		}
+		return t_ring;
+	}
+
+	void Profiler::record(const char* name, uint64_t start, uint64_t end)
+	{
+		ProfileRing* ring = getThreadRing();
+		uint64_t head = ring->head.load(std::memory_order_relaxed);
+		if (head - ring->tail.load(std::memory_order_acquire) >= cnst_profiler_ring_size)
+		{
+			ring->dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		ring->events[head & (cnst_profiler_ring_size - 1)] = { name, start, end };
+		ring->head.store(head + 1, std::memory_order_release);
+	}
+
+	void Profiler::setThreadName(std::string name)
+	{
+		//rings are allocated by the first recorded zone, naming a thread alone must not cost one
+		t_threadName = name;
+		if (t_ring == nullptr)
+			return;
+		std::lock_guard<std::mutex> guard(s_ringLock);
+		t_ring->threadName = name;
+	}
+
+	uint64_t Profiler::getDroppedCount()
+	{
+		std::lock_guard<std::mutex> guard(s_ringLock);
+		uint64_t total = 0;
+		for (auto& ring : s_rings)
+			total += ring->dropped.load();
+		return total;
+	}
+
+	static void writeJsonString(std::ofstream& file, const std::string& s)
+	{
+		file << '"';
+		for (char c : s)
+		{
+			if (c == '"' || c == '\\')
+				file << '\\' << c;
+			else if ((unsigned char)c < 0x20)
+				file << ' ';
+			else
+				file << c;
+		}
+		file << '"';
+	}
+
+	bool Profiler::exportChromeTrace(std::string path)
+	{
+		std::ofstream file(path);
+		if (!file.is_open())
+			return false;
+
+		std::lock_guard<std::mutex> guard(s_ringLock);
+		//timestamps are relative to the oldest pending zone
+		uint64_t origin = UINT64_MAX;
+		for (auto& ring : s_rings)
+		{
+			uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+			if (tail != ring->head.load(std::memory_order_acquire))
+			{
+				uint64_t start = ring->events[tail & (cnst_profiler_ring_size - 1)].start;
+				if (start < origin) origin = start;
+			}
+		}
+		if (origin == UINT64_MAX)
+			origin = 0;
+
+		file << "{\"traceEvents\":[\n";
+		bool first = true;
+		file.precision(3);
+		file << std::fixed;
+		for (auto& ring : s_rings)
+		{
+			if (!first) file << ",\n";
+			first = false;
+			file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << ring->threadId << ",\"args\":{\"name\":";
+			writeJsonString(file, ring->threadName);
+			file << "}}";
+
+			uint64_t head = ring->head.load(std::memory_order_acquire);
+			uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+			for (; tail != head; tail++)
+			{
+				const ProfileEvent& e = ring->events[tail & (cnst_profiler_ring_size - 1)];
+				file << ",\n{\"name\":";
+				writeJsonString(file, e.name);
+				file << ",\"cat\":\"sp\",\"ph\":\"X\",\"pid\":1,\"tid\":" << ring->threadId
+					<< ",\"ts\":" << double(e.start - origin) / 1000.0
+					<< ",\"dur\":" << double(e.end - e.start) / 1000.0 << "}";
+			}
+			ring->tail.store(tail, std::memory_order_release);
+		}
+		file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+		return true;
+	}
+
+	void Profiler::clear()
+	{
+		std::lock_guard<std::mutex> guard(s_ringLock);
+		for (auto& ring : s_rings)
+		{
+			ring->tail.store(ring->head.load(std::memory_order_acquire), std::memory_order_release);
+			ring->dropped = 0;
+		}
+	}
+
+};
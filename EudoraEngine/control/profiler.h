@@ -0,0 +1,66 @@
+#pragma once
+#include "../api.h"
+#include "utils.h"
+#include <atomic>
+#include <string>
+
+#define sp_profile_concat_inner(a, b) a##b
+#define sp_profile_concat(a, b) sp_profile_concat_inner(a, b)
+
+//scoped cpu zones, name must be a string literal (only the pointer is stored)
+//define SP_NO_PROFILE to compile every zone out
+#ifndef SP_NO_PROFILE
+#define sp_profile_scope(name) sp::ProfileZone sp_profile_concat(sp_profile_zone_, __LINE__)(name)
+#define sp_profile_function() sp_profile_scope(__FUNCTION__)
+#else
+#define sp_profile_scope(name)
+#define sp_profile_function()
+#endif
+
+namespace sp {
+
+	//one completed zone
+	struct ProfileEvent
+	{
+		const char* name;
+		uint64_t start; // ns
+		uint64_t end; // ns
+	};
+
+	//collects zones into per thread lock free ring buffers
+	//only the owning thread writes its ring, export drains them from any thread
+	//when disabled at runtime a zone costs one relaxed atomic load
+	class SP_API Profiler
+	{
+	private:
+		static std::atomic<bool> _enabled;
+	public:
+		static bool isEnabled() { return _enabled.load(std::memory_order_relaxed); }
+		static void setEnabled(bool enabled) { _enabled.store(enabled, std::memory_order_relaxed); }
+
+		static void record(const char* name, uint64_t start, uint64_t end);
+		static void setThreadName(std::string name); // shown as the track name in the trace
+		static uint64_t getDroppedCount(); // zones lost because a ring was full
+
+		static bool exportChromeTrace(std::string path); // drains all rings into chrome://tracing json
+		static void clear();
+	};
+
+	class ProfileZone
+	{
+	private:
+		const char* _name;
+		uint64_t _start;
+	public:
+		ProfileZone(const char* name)
+			: _name(name), _start(Profiler::isEnabled() ? Clock::now_ns() : 0) {}
+		~ProfileZone()
+		{
+			if (_start != 0)
+				Profiler::record(_name, _start, Clock::now_ns());
+		}
+		ProfileZone(const ProfileZone&) = delete;
+		ProfileZone& operator=(const ProfileZone&) = delete;
+	};
+
+};
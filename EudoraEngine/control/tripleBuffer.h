@@ -0,0 +1,56 @@
+#pragma once
+#include "../api.h"
+#include <atomic>
+
+namespace sp {
+
+	//lock free single producer / single consumer state handoff
+	//the producer fills write() and calls publish(), the consumer calls acquire() and reads read()
+	//neither side ever blocks and the reader always sees a complete block
+	//note: write() hands back a recycled buffer, overwrite the whole block before publishing
+	template<typename T>
+	class TripleBuffer
+	{
+	private:
+		static const uint cnst_fresh_bit = 0x4;
+		static const uint cnst_index_mask = 0x3;
+
+		T _buffers[3];
+		uint _back = 0; // owned by producer
+		uint _front = 2; // owned by consumer
+		std::atomic<uint> _middle{ 1 }; // shared, carries the fresh bit
+	public:
+		TripleBuffer() {}
+		TripleBuffer(const T& initial)
+		{
+			_buffers[0] = initial;
+			_buffers[1] = initial;
+			_buffers[2] = initial;
+		}
+
+		//producer side
+		T& write() { return _buffers[_back]; }
+		void publish()
+		{
+			uint previous = _middle.exchange(_back | cnst_fresh_bit, std::memory_order_acq_rel);
+			_back = previous & cnst_index_mask;
+		}
+		void publish(const T& value)
+		{
+			_buffers[_back] = value;
+			publish();
+		}
+
+		//consumer side, returns false if nothing new was published since the last acquire
+		bool acquire()
+		{
+			if ((_middle.load(std::memory_order_relaxed) & cnst_fresh_bit) == 0)
+				return false;
+			uint previous = _middle.exchange(_front, std::memory_order_acq_rel);
+			_front = previous & cnst_index_mask;
+			return true;
+		}
+		const T& read() const { return _buffers[_front]; }
+	};
+
+};
@@ -1,5 +1,7 @@
 #include "utils.h"
 #include <SDL.h>
+#include <chrono>
+#include <thread>
 
 namespace sp {
 
@@ -33,7 +35,22 @@ namespace sp {
 	}
 
 
+	uint64_t Clock::now_ns()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	void Clock::sleepUntil(uint64_t deadline_ns)
+	{
+		//os sleep is only accurate to ~1ms, so leave a margin and spin the rest
+		const uint64_t spin_margin = 1500000;
+		uint64_t now = now_ns();
+		if (deadline_ns > now + spin_margin)
+			std::this_thread::sleep_for(std::chrono::nanoseconds(deadline_ns - now - spin_margin));
+		while (now_ns() < deadline_ns)
+			std::this_thread::yield();
+	}
 
 
 };
-
@@ -1,5 +1,6 @@
 #pragma once
 #include "../api.h"
+#include <cstdint>
 
 namespace sp {
 
@@ -15,5 +16,15 @@ namespace sp {
 		float fraction();
 	};
 
+	//monotonic high resolution clock
+	//all values are in nanoseconds unless stated otherwise
+	class SP_API Clock {
+	public:
+		static uint64_t now_ns();
+		static double toSeconds(uint64_t ns) { return double(ns) * 1e-9; }
+		static uint64_t fromSeconds(double s) { return uint64_t(s * 1e9); }
+		static void sleepUntil(uint64_t deadline_ns); // sleeps coarse then spins for the last stretch
+	};
+
 
 }
@@ -3,21 +3,66 @@
 #include <iostream>
 #include "deps/glad.h"
 #include "console.h"
+#include "render/renderer.h"
+#include "render/glDebug.h"
+#include "render/renderStats.h"
+#include "render/renderTargetPool.h"
+#include "control/latencyTracker.h"
+#include "control/logger.h"
+#include "control/profiler.h"
+#ifdef SP_HEADLESS_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
 
 namespace sp {
 
-
-	//opengl debug callback
-	void GLAPIENTRY error_callback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar* message, const void* useParam)
+	Display::Display(int width, int height, const char* title, DisplayMode mode)
+		:_width(width),
+		_height(height),
+		_mode(mode)
 	{
-		sp::Console::gl_debug(type, message);
+		if (_mode == DisplayMode::headless)
+			createHeadless(title);
+		else
+			createWindow(title);
 	}
 
+	Display::~Display()
+	{
+		releaseFrameFences();
+		if (_offscreen) {
+			delete _offscreen;
+			_offscreen = nullptr;
+		}
+		//pooled attachments die with the context
+		RenderTargetPool::trim();
+#ifdef SP_HEADLESS_EGL
+		if (_eglDisplay) {
+			EGLDisplay dpy = reinterpret_cast<EGLDisplay>(_eglDisplay);
+			eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+			if (_context)
+				eglDestroyContext(dpy, reinterpret_cast<EGLContext>(_context));
+			if (_eglSurface)
+				eglDestroySurface(dpy, reinterpret_cast<EGLSurface>(_eglSurface));
+			eglTerminate(dpy);
+			_eglDisplay = nullptr;
+			_eglSurface = nullptr;
+			_context = nullptr;
+		}
+#endif
+		if (_window) {
+			//cleanup sdl
+			SDL_GL_DeleteContext(reinterpret_cast<SDL_GLContext>(_context));
+			SDL_DestroyWindow(reinterpret_cast<SDL_Window*>(_window));
+			SDL_Quit();
+			_window = nullptr;
+			_context = nullptr;
 
+		}
+	}
 
-	Display::Display(int width, int height, const char* title)
-		:_width(width),
-		_height(height)
+	void Display::createWindow(const char* title)
 	{
 		//initialize sdl
 		if (SDL_Init(SDL_INIT_EVERYTHING) < 0) // on success returns 0
@@ -25,6 +70,20 @@ namespace sp {
 			Console::err("cannot innitialize sdl", SDL_GetError());
 		}
 		SDL_GL_LoadLibrary(NULL);
+		//set opengl hints, they only apply to contexts created after this
+		SDL_GL_SetAttribute(SDL_GL_ACCELERATED_VISUAL, 1);
+		SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 4);
+		SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 4);
+		SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+		if (cnst_gl_debug_default)
+			SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS, SDL_GL_CONTEXT_DEBUG_FLAG);
+		SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
+		SDL_GL_SetAttribute(SDL_GL_RED_SIZE, 8);
+		SDL_GL_SetAttribute(SDL_GL_GREEN_SIZE, 8);
+		SDL_GL_SetAttribute(SDL_GL_BLUE_SIZE, 8);
+		SDL_GL_SetAttribute(SDL_GL_ALPHA_SIZE, 8);
+		SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 24);
+		SDL_GL_SetAttribute(SDL_GL_STENCIL_SIZE, 8);
 		_window = SDL_CreateWindow(title,	//title
 				SDL_WINDOWPOS_UNDEFINED,	//x cord
 				SDL_WINDOWPOS_UNDEFINED,	//ycord
@@ -38,18 +97,9 @@ namespace sp {
 		else {
 			//create opengl context
 			_context = SDL_GL_CreateContext(reinterpret_cast<SDL_Window*>(_window));
-			//set opengl hints
-			SDL_GL_SetAttribute(SDL_GL_ACCELERATED_VISUAL, 1);
-			SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 4);
-			SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 4);
-			SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
-			SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
-			SDL_GL_SetAttribute(SDL_GL_RED_SIZE, 8);
-			SDL_GL_SetAttribute(SDL_GL_GREEN_SIZE, 8);
-			SDL_GL_SetAttribute(SDL_GL_BLUE_SIZE, 8);
-			SDL_GL_SetAttribute(SDL_GL_ALPHA_SIZE, 8);
-			SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 24);
-			SDL_GL_SetAttribute(SDL_GL_STENCIL_SIZE, 8);
+			if (!_context) {
+				Console::err("opengl 4.4 core context creation failed", SDL_GetError());
+			}
 
 			SDL_GetWindowSize(reinterpret_cast<SDL_Window*>(_window), &_width, &_height);
 
@@ -57,35 +107,122 @@ namespace sp {
 			if (!gladLoadGLLoader((GLADloadproc)SDL_GL_GetProcAddress)) {
 				Console::err("failed to initialize glad", "application.cpp");
 			}
+			initGL();
+			setPresentMode(_presentMode);
+		}
+	}
 
-			glEnable(GL_DEBUG_OUTPUT);
-			glDebugMessageCallback(error_callback, 0);
+	void Display::createHeadless(const char* title)
+	{
+		if (!createEglContext())
+		{
+			//fallback: hidden sdl window, only the subsystems we need
+			if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_TIMER | SDL_INIT_EVENTS) < 0)
+			{
+				Console::err("cannot innitialize sdl for headless display", SDL_GetError());
+			}
+			SDL_GL_LoadLibrary(NULL);
+			SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 4);
+			SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 4);
+			SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+			_window = SDL_CreateWindow(title, SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
+				_width, _height, SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+			if (!_window) {
+				Console::err("headless window construction failed", SDL_GetError());
+			}
+			_context = SDL_GL_CreateContext(reinterpret_cast<SDL_Window*>(_window));
+			if (!gladLoadGLLoader((GLADloadproc)SDL_GL_GetProcAddress)) {
+				Console::err("failed to initialize glad", "Display::createHeadless");
+			}
+			SDL_GL_SetSwapInterval(0);
+		}
+		initGL();
+		//hidden or missing default framebuffers have undefined contents, render into our own
+		_offscreen = new FrameBuffer(_width, _height);
+		bindScreenTarget();
+	}
 
+	bool Display::createEglContext()
+	{
+#ifdef SP_HEADLESS_EGL
+		EGLDisplay dpy = EGL_NO_DISPLAY;
+		PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+			(PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+		if (getPlatformDisplay)
+			dpy = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+		if (dpy == EGL_NO_DISPLAY)
+			dpy = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+		if (dpy == EGL_NO_DISPLAY || !eglInitialize(dpy, nullptr, nullptr))
+			return false;
 
-			glViewport(0, 0, getWidth(), getHeight());
-			glEnable(GL_DEPTH_TEST);
-			SDL_GL_SetSwapInterval(1);
+		const EGLint pbuffer_config[] = {
+			EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+			EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+			EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_ALPHA_SIZE, 8,
+			EGL_DEPTH_SIZE, 24, EGL_STENCIL_SIZE, 8,
+			EGL_NONE };
+		const EGLint surfaceless_config[] = {
+			EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+			EGL_NONE };
+		EGLConfig config;
+		EGLint num_config = 0;
+		bool pbuffer = eglChooseConfig(dpy, pbuffer_config, &config, 1, &num_config) && num_config > 0;
+		if (!pbuffer && !(eglChooseConfig(dpy, surfaceless_config, &config, 1, &num_config) && num_config > 0))
+		{
+			eglTerminate(dpy);
+			return false;
+		}
+
+		EGLSurface surface = EGL_NO_SURFACE;
+		if (pbuffer)
+		{
+			const EGLint pbuffer_attribs[] = { EGL_WIDTH, _width, EGL_HEIGHT, _height, EGL_NONE };
+			surface = eglCreatePbufferSurface(dpy, config, pbuffer_attribs);
+		}
 
-			setClearColor(0.16f, 0.713f, 0.964f, 1);
+		eglBindAPI(EGL_OPENGL_API);
+		const EGLint context_attribs[] = {
+			EGL_CONTEXT_MAJOR_VERSION, 4,
+			EGL_CONTEXT_MINOR_VERSION, 4,
+			EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+			EGL_NONE };
+		EGLContext context = eglCreateContext(dpy, config, EGL_NO_CONTEXT, context_attribs);
+		if (context == EGL_NO_CONTEXT || !eglMakeCurrent(dpy, surface, surface, context))
+		{
+			if (context != EGL_NO_CONTEXT)
+				eglDestroyContext(dpy, context);
+			if (surface != EGL_NO_SURFACE)
+				eglDestroySurface(dpy, surface);
+			eglTerminate(dpy);
+			return false;
 		}
+		_eglDisplay = dpy;
+		_eglSurface = surface;
+		_context = context;
 
+		if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress)) {
+			Console::err("failed to initialize glad", "Display::createEglContext");
+		}
+		return true;
+#else
+		return false;
+#endif
 	}
 
-	Display::~Display()
+	void Display::initGL()
 	{
-		if (_window) {
-			//cleanup sdl
-			SDL_GL_DeleteContext(reinterpret_cast<SDL_GLContext>(_context));
-			SDL_DestroyWindow(reinterpret_cast<SDL_Window*>(_window));
-			SDL_Quit();
-			_window = nullptr;
-			_context = nullptr;
+		GLDebug::setEnabled(cnst_gl_debug_default);
 
-		}
+		glViewport(0, 0, getWidth(), getHeight());
+		glEnable(GL_DEPTH_TEST);
+
+		setClearColor(0.16f, 0.713f, 0.964f, 1);
 	}
 
 	void Display::show(bool should)
 	{
+		if (_mode == DisplayMode::headless)
+			return;
 		if (_window) {
 			SDL_Window* win = reinterpret_cast<SDL_Window*>(_window);
 			if (should)
@@ -94,22 +231,112 @@ namespace sp {
 				SDL_HideWindow(win);
 		}
 		else {
-			std::cout << "err: Display is not initialized. window returns nullptr\n";
+			Logger::warn(LogCategory::app, "Display is not initialized. window returns nullptr");
 		}
 	}
 
 	void Display::onUpdate()
 	{
+		if (_mode == DisplayMode::headless)
+		{
+			//nothing throttles us without a swap, wait for the gpu so frame timings are real
+			glFinish();
+			LatencyTracker::markPresent();
+			GLDebug::onFrame();
+			RenderStats::endFrame();
+			RenderTargetPool::onFrame();
+			return;
+		}
 		SDL_GL_SwapWindow(reinterpret_cast<SDL_Window*>(_window));
-	
+		limitFramesInFlight();
+		LatencyTracker::markPresent();
+		GLDebug::onFrame();
+		RenderStats::endFrame();
+		RenderTargetPool::onFrame();
 	}
 
 	void Display::resizeWindow(int width, int height)
 	{
+		if (_mode == DisplayMode::headless)
+		{
+			_width = width;
+			_height = height;
+			_offscreen->setDimension(width, height);
+			return;
+		}
 		SDL_SetWindowSize(reinterpret_cast<SDL_Window*>(_window), width, height);
 		SDL_GetWindowSize(reinterpret_cast<SDL_Window*>(_window), &_width, &_height);
 	}
 
+	void Display::bindScreenTarget()
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, getScreenFrameBufferId());
+	}
+
+	bool Display::captureFrame(std::string path)
+	{
+		std::vector<byte> pixels(_width * _height * 4);
+		bindScreenTarget();
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		glReadPixels(0, 0, _width, _height, GL_RGBA, GL_UNSIGNED_BYTE, &pixels[0]);
+		ImageData image(&pixels[0], _width, _height, 4);
+		ImageData::flipImageY(&image); // gl origin is bottom left
+		return ImageData::saveImage_png(&image, path);
+	}
+
+	uint Display::getScreenFrameBufferId() const
+	{
+		return _offscreen ? _offscreen->getFrameBufferId() : 0;
+	}
+
+	bool Display::setPresentMode(PresentMode mode)
+	{
+		_presentMode = mode;
+		if (_mode == DisplayMode::headless)
+			return true; // nothing is presented, frames are paced by glFinish
+		if (SDL_GL_SetSwapInterval(static_cast<int>(mode)) == 0)
+			return true;
+		if (mode == PresentMode::adaptive)
+		{
+			Logger::warn(LogCategory::gl, "adaptive vsync is not supported, falling back to vsync");
+			_presentMode = PresentMode::vsync;
+			SDL_GL_SetSwapInterval(1);
+		}
+		else
+			Logger::warn(LogCategory::gl, "swap interval {} rejected: {}", static_cast<int>(mode), SDL_GetError());
+		return false;
+	}
+
+	void Display::setMaxFramesInFlight(uint frames)
+	{
+		_maxFramesInFlight = frames;
+		if (frames == 0)
+			releaseFrameFences();
+	}
+
+	void Display::limitFramesInFlight()
+	{
+		if (_maxFramesInFlight == 0)
+			return;
+		_frameFences.push_back(glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+		//block on the oldest frames until only max - 1 are still queued behind this one
+		while (_frameFences.size() > _maxFramesInFlight)
+		{
+			GLsync fence = reinterpret_cast<GLsync>(_frameFences.front());
+			sp_profile_scope("Display::waitFrameInFlight");
+			while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 100000000) == GL_TIMEOUT_EXPIRED) {}
+			glDeleteSync(fence);
+			_frameFences.erase(_frameFences.begin());
+		}
+	}
+
+	void Display::releaseFrameFences()
+	{
+		for (void* fence : _frameFences)
+			glDeleteSync(reinterpret_cast<GLsync>(fence));
+		_frameFences.clear();
+	}
+
 	void Display::setClearColor(float r, float g, float b, float a)
 	{
 		glClearColor(r, g, b, a);
@@ -1,30 +1,81 @@
 #pragma once
 #include "api.h"
 #include <vector>
+#include <string>
 
 
 
 namespace sp {
 
+	class FrameBuffer;
+
+	//window: visible sdl window
+	//headless: offscreen gl context, frames go into an internal framebuffer
+	//          uses egl (pbuffer/surfaceless, works on mesa llvmpipe) when built with SP_HEADLESS_EGL
+	//          otherwise a hidden sdl window (set SDL_VIDEODRIVER=offscreen on machines without a display server)
+	enum class DisplayMode
+	{
+		window = 0,
+		headless = 1
+	};
+
+	//swap interval used when presenting
+	//vsync: wait for vblank, adaptive: vsync but tear instead of waiting when a frame is late, immediate: never wait
+	enum class PresentMode
+	{
+		immediate = 0,
+		vsync = 1,
+		adaptive = -1
+	};
+
+	const uint cnst_default_frames_in_flight = 2;
+
 	//class responsible for creating window
 	class SP_API Display
 	{
 	private:
 		void* _window = nullptr;
 		void* _context = nullptr;
+		void* _eglDisplay = nullptr;
+		void* _eglSurface = nullptr;
 		int _width = 640;
 		int _height = 480;
+		DisplayMode _mode = DisplayMode::window;
+		FrameBuffer* _offscreen = nullptr; // screen target in headless mode
+		PresentMode _presentMode = PresentMode::vsync;
+		uint _maxFramesInFlight = cnst_default_frames_in_flight;
+		std::vector<void*> _frameFences; // one sync object per presented frame, oldest first
 	public:
-		Display(int width, int height, const char* title);
+		Display(int width, int height, const char* title, DisplayMode mode = DisplayMode::window);
 		~Display();
 		void show(bool should = true);
 		void onUpdate();
 		void resizeWindow(int width, int height);
+		void bindScreenTarget(); // binds the framebuffer frames are presented from
+		bool captureFrame(std::string path); // saves the current screen target as png
 		int getWidth() const { return _width; }
 		int getHeight() const { return _height; }
 		void* getWindowHandle() { return _window; }
+		bool isHeadless() const { return _mode == DisplayMode::headless; }
+		uint getScreenFrameBufferId() const;
+
+		//returns false if the driver refused the mode, adaptive falls back to vsync
+		bool setPresentMode(PresentMode mode);
+		PresentMode getPresentMode() const { return _presentMode; }
+		//cpu may queue at most this many frames ahead of the gpu, lower is less latency, higher is more throughput
+		//0 leaves it to the driver
+		void setMaxFramesInFlight(uint frames);
+		uint getMaxFramesInFlight() const { return _maxFramesInFlight; }
 
 		static void setClearColor(float r, float g, float b, float a);
+
+	private:
+		void createWindow(const char* title);
+		void createHeadless(const char* title);
+		bool createEglContext();
+		void initGL();
+		void limitFramesInFlight();
+		void releaseFrameFences();
 	};
 
-}
\ No newline at end of file
+}
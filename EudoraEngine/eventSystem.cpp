@@ -1,20 +1,45 @@
 #include "eventSystem.h"
 #include <SDL.h>
 #include <iostream>
-#include <map>
 #include "application.h"
+#include "inputRecorder.h"
+#include "inputQueue.h"
+#include "control/utils.h"
+#include "control/latencyTracker.h"
+#include "control/logger.h"
+#include "console.h"
+#include "control/profiler.h"
 
 namespace sp {
 
+	//event type of each dispatch bucket
+	static const EventType cnst_bucket_types[cnst_event_bucket_count] = {
+		EventType::none, EventType::key_down, EventType::key_up, EventType::key_hold, EventType::click,
+		EventType::mouse_move, EventType::mouse_down, EventType::mouse_up, EventType::mouse_wheel,
+		EventType::mouse_down_left, EventType::mouse_up_left, EventType::mouse_down_right,
+		EventType::mouse_up_right, EventType::mouse_down_middle, EventType::mouse_up_middle };
+
 	MouseEventInfo EventSystem::Mouse;
 	KeyEventInfo EventSystem::Keyboard;
 
 	bool EventSystem::_shouldQuit = false;
 	uint EventSystem::_controlWord = 0x00010000;
-	std::vector<EventHandlerInfo> EventSystem::_events = {};
+	std::deque<EventSystem::ListenerSlot> EventSystem::_slots = {};
+	std::vector<uint> EventSystem::_freeSlots = {};
+	std::vector<uint> EventSystem::_releasedSlots = {};
+	std::vector<EventSystem::BucketEntry> EventSystem::_buckets[cnst_event_bucket_count];
+	uint EventSystem::_staleEntries[cnst_event_bucket_count] = {};
+	uint EventSystem::_sequence = 0;
+	bool EventSystem::_dispatching = false;
+	std::vector<uint> EventSystem::_deferredInserts = {};
 	std::vector<KeyCode> EventSystem::_pressedKeys = {};
 	std::vector<KeyCode> EventSystem::_releasedKeys = {};
 	std::vector<KeyCode> EventSystem::_heldKeys = {};
+	KeyBitset EventSystem::_pressedState;
+	KeyBitset EventSystem::_releasedState;
+	KeyBitset EventSystem::_heldState;
+	bool EventSystem::_recordMouseHistory = false;
+	std::vector<MouseSample> EventSystem::_mouseHistory = {};
 
 	
 	void EventSystem::resetControlWord()
@@ -29,179 +54,313 @@ namespace sp {
 
 	void EventSystem::pollFromWindow(void* window)
 	{
+		sp_profile_function();
 		SDL_Window* win = reinterpret_cast<SDL_Window*>(window);
 		if (!win) {
-			std::cout << "err: nullptr is passed while polling events\n";
+			Logger::warn(LogCategory::input, "nullptr is passed while polling events");
 			return;
 		}
-		_pressedKeys = {};
-		_releasedKeys = {};
-		std::vector<KeyCode>::iterator it;
+		//translate sdl events to raw events first so live and replayed input take the same path
+		std::vector<RawInputEvent> events = {};
+		//sdl stamps events in ms since init, map them onto Clock so latency includes time spent queued
+		bool track_latency = LatencyTracker::isEnabled();
+		uint64_t tick_origin = Clock::now_ns() - uint64_t(SDL_GetTicks()) * 1000000;
 		SDL_Event ev;
 		while (SDL_PollEvent(&ev)) {
-			if (ev.type == SDL_QUIT)
-				_shouldQuit = true;
-
+			RawInputEvent raw;
 			switch (ev.type)
 			{
+			case SDL_QUIT:
+				raw.type = RawInputType::quit;
+				break;
 			case SDL_KEYDOWN:
-				addControlWord(static_cast<uint>(EventType::key_down));
-				it = std::find(_heldKeys.begin(), _heldKeys.end(), static_cast<KeyCode>(ev.key.keysym.sym));
-				if (it == _heldKeys.end()) {
-					_pressedKeys.push_back(static_cast<KeyCode>(ev.key.keysym.sym));
-					_heldKeys.push_back(static_cast<KeyCode>(ev.key.keysym.sym));
-				}
+				raw.type = RawInputType::key_down;
+				raw.key = ev.key.keysym.sym;
 				break;
 			case SDL_KEYUP:
-				addControlWord(static_cast<uint>(EventType::key_up));
-				_releasedKeys.push_back(static_cast<KeyCode>(ev.key.keysym.sym));
-				it = std::find(_heldKeys.begin(), _heldKeys.end(), static_cast<KeyCode>(ev.key.keysym.sym));
-				if (it != _heldKeys.end())
-					_heldKeys.erase(it);
+				raw.type = RawInputType::key_up;
+				raw.key = ev.key.keysym.sym;
 				break;
 			case SDL_MOUSEMOTION:
-				addControlWord(static_cast<uint>(EventType::mouse_move));
-				Mouse.x = (float)ev.motion.x * 2 /Application::getWidth() - 1.0f;
-				Mouse.y = 1.0f - (float)ev.motion.y * 2 /Application::getHeight() ;
-				Mouse.dx = (float)ev.motion.xrel;
-				Mouse.dy = (float)ev.motion.yrel;
-				Mouse.screenX = ev.motion.x;
-				Mouse.screenY = ev.motion.y;
+				raw.type = RawInputType::mouse_move;
+				raw.x = ev.motion.x;
+				raw.y = ev.motion.y;
+				raw.dx = ev.motion.xrel;
+				raw.dy = ev.motion.yrel;
 				break;
 			case SDL_MOUSEBUTTONDOWN:
-
-				if (ev.button.button == SDL_BUTTON_LEFT)
-				{
-					addControlWord(static_cast<uint>(EventType::mouse_down_left));
-				}
-				else if (ev.button.button == SDL_BUTTON_RIGHT)
-				{
-					addControlWord(static_cast<uint>(EventType::mouse_down_right));
-				}
-				else if (ev.button.button == SDL_BUTTON_MIDDLE)
-				{
-					addControlWord(static_cast<uint>(EventType::mouse_down_middle));
-				}
+				raw.type = RawInputType::mouse_button_down;
+				raw.button = ev.button.button;
 				break;
 			case SDL_MOUSEBUTTONUP:
-
-				if (ev.button.button == SDL_BUTTON_LEFT)
-				{
-					addControlWord(static_cast<uint>(EventType::mouse_up_left));
-				}
-				else if (ev.button.button == SDL_BUTTON_RIGHT)
-				{
-					addControlWord(static_cast<uint>(EventType::mouse_up_right));
-				}
-				else if (ev.button.button == SDL_BUTTON_MIDDLE)
-				{
-					addControlWord(static_cast<uint>(EventType::mouse_up_middle));
-				}
+				raw.type = RawInputType::mouse_button_up;
+				raw.button = ev.button.button;
 				break;
 			case SDL_MOUSEWHEEL:
+				raw.type = RawInputType::mouse_wheel;
+				raw.x = ev.wheel.x;
+				raw.y = ev.wheel.y;
 				break;
-				addControlWord(static_cast<uint>(EventType::mouse_wheel));
+			default:
+				continue;
 			}
+			raw.time_ns = tick_origin + uint64_t(ev.common.timestamp) * 1000000;
+			events.push_back(raw);
+			if (track_latency)
+				LatencyTracker::recordInput(raw.time_ns);
 		} // while loop for polling events ends here
-
+		InputRecorder::captureEvents(events);
+		injectEvents(events);
 	}
 
-	void EventSystem::resolve()
+	bool EventSystem::peekMouseMotion(float& dx, float& dy)
 	{
-		std::map<EventType, bool> mask_flags = {};
-		std::map<EventType, byte> priority_flags = {};
-
-		if (_heldKeys.size() > 0)
-			addControlWord(static_cast<uint>(EventType::key_hold));
-
-
+		dx = 0.0f;
+		dy = 0.0f;
+		Display* display = Application::getMainDisplay();
+		if (InputRecorder::isReplaying() || display == nullptr || display->isHeadless())
+			return false;
+		const int max_events = 256;
+		SDL_Event events[max_events];
+		SDL_PumpEvents();
+		int count = SDL_PeepEvents(events, max_events, SDL_PEEKEVENT, SDL_MOUSEMOTION, SDL_MOUSEMOTION);
+		for (int i = 0; i < count; i++)
+		{
+			dx += (float)events[i].motion.xrel;
+			dy += (float)events[i].motion.yrel;
+		}
+		return count > 0;
+	}
 
+	void EventSystem::injectEvents(const std::vector<RawInputEvent>& events)
+	{
+		_pressedKeys.clear();
+		_releasedKeys.clear();
+		_pressedState.clear();
+		_releasedState.clear();
+		//motion is coalesced per frame, a frame without motion has zero delta
+		Mouse.dx = 0.0f;
+		Mouse.dy = 0.0f;
+		Mouse.wheelX = 0;
+		Mouse.wheelY = 0;
+		_mouseHistory.clear();
+		uint64_t now = Clock::now_ns();
+		TimedInputEvent timed;
+		for (const RawInputEvent& ev : events)
+		{
+			timed.time_ns = ev.time_ns != 0 ? ev.time_ns : now;
+			timed.event = ev;
+			InputQueue::publish(timed);
+			applyRawEvent(ev);
+		}
+	}
 
+	void EventSystem::applyRawEvent(const RawInputEvent& ev)
+	{
+		std::vector<KeyCode>::iterator it;
+		KeyCode key = static_cast<KeyCode>(ev.key);
+		uint index = getKeyIndex(key);
+		switch (ev.type)
+		{
+		case RawInputType::quit:
+			_shouldQuit = true;
+			break;
+		case RawInputType::key_down:
+			addControlWord(static_cast<uint>(EventType::key_down));
+			if (!_heldState.test(index)) {
+				_pressedKeys.push_back(key);
+				_heldKeys.push_back(key);
+				_pressedState.set(index);
+				_heldState.set(index);
+			}
+			break;
+		case RawInputType::key_up:
+			addControlWord(static_cast<uint>(EventType::key_up));
+			_releasedKeys.push_back(key);
+			_releasedState.set(index);
+			_heldState.reset(index);
+			it = std::find(_heldKeys.begin(), _heldKeys.end(), key);
+			if (it != _heldKeys.end())
+				_heldKeys.erase(it);
+			break;
+		case RawInputType::mouse_move:
+			addControlWord(static_cast<uint>(EventType::mouse_move));
+			Mouse.x = (float)ev.x * 2 /Application::getWidth() - 1.0f;
+			Mouse.y = 1.0f - (float)ev.y * 2 /Application::getHeight() ;
+			Mouse.dx += (float)ev.dx;
+			Mouse.dy += (float)ev.dy;
+			Mouse.screenX = ev.x;
+			Mouse.screenY = ev.y;
+			if (_recordMouseHistory)
+				_mouseHistory.push_back({ ev.x, ev.y, ev.dx, ev.dy });
+			break;
+		case RawInputType::mouse_button_down:
+
+			if (ev.button == SDL_BUTTON_LEFT)
+			{
+				addControlWord(static_cast<uint>(EventType::mouse_down_left));
+			}
+			else if (ev.button == SDL_BUTTON_RIGHT)
+			{
+				addControlWord(static_cast<uint>(EventType::mouse_down_right));
+			}
+			else if (ev.button == SDL_BUTTON_MIDDLE)
+			{
+				addControlWord(static_cast<uint>(EventType::mouse_down_middle));
+			}
+			break;
+		case RawInputType::mouse_button_up:
 
-		for (auto listener : _events){
-			if (mask_flags.count(listener.type) == 0){
-				mask_flags[listener.type] = false;
-				priority_flags[listener.type] = listener.priority;
+			if (ev.button == SDL_BUTTON_LEFT)
+			{
+				addControlWord(static_cast<uint>(EventType::mouse_up_left));
 			}
-			
+			else if (ev.button == SDL_BUTTON_RIGHT)
+			{
+				addControlWord(static_cast<uint>(EventType::mouse_up_right));
+			}
+			else if (ev.button == SDL_BUTTON_MIDDLE)
+			{
+				addControlWord(static_cast<uint>(EventType::mouse_up_middle));
+			}
+			break;
+		case RawInputType::mouse_wheel:
+			addControlWord(static_cast<uint>(EventType::mouse_wheel));
+			Mouse.wheelX += ev.x;
+			Mouse.wheelY += ev.y;
+			break;
+		}
+	}
 
-			if ((mask_flags[listener.type] == true) && (priority_flags[listener.type] > listener.priority)){
+	void EventSystem::resolve()
+	{
+		sp_profile_function();
+		if (_heldKeys.size() > 0)
+			addControlWord(static_cast<uint>(EventType::key_hold));
 
-				continue;
+		//only buckets whose type is fully present in the control word take part
+		uint matched[cnst_event_bucket_count];
+		size_t cursor[cnst_event_bucket_count];
+		int maskPriority[cnst_event_bucket_count]; // -1 until a masking listener ran
+		uint count = 0;
+		for (uint b = 0; b < cnst_event_bucket_count; b++)
+		{
+			if (_buckets[b].size() > _staleEntries[b] && matchSequence(_controlWord, static_cast<uint>(cnst_bucket_types[b])))
+			{
+				matched[count] = b;
+				cursor[count] = 0;
+				maskPriority[count] = -1;
+				count++;
 			}
-			if (matchSequence(_controlWord, static_cast<uint>(listener.type))) {
-				bool satisfies = true;
-				switch (listener.type)
-				{
-				case EventType::key_down:
-				{
-					KeyEventInfo* ef = new KeyEventInfo();
-					for (auto k : _pressedKeys) {
-						ef->timeStamp = SDL_GetTicks();
-						ef->type = EventType::key_down;
-						ef->keyCode = k;
-						ef->state = 1;
-						ef->heldKeys = _heldKeys;
-						Keyboard = *ef;
-						listener.handler(ef);
-					}
-					delete ef;
-				}
-					break;
-				case EventType::key_up:
-				{
-					KeyEventInfo* ef = new KeyEventInfo();
-					for (auto k : _releasedKeys) {
-						ef->timeStamp = SDL_GetTicks();
-						ef->type = EventType::key_up;
-						ef->keyCode = k;
-						ef->state = 2;
-						ef->heldKeys = _heldKeys;
-						Keyboard = *ef;
-						listener.handler(ef);
-					}
-					delete ef;
-				}
-				case EventType::key_hold:
+		}
+
+		uint timeStamp = SDL_GetTicks();
+		if (count > 0)
+			Keyboard.heldKeys = _heldKeys;
+		_dispatching = true;
+		while (count > 0)
+		{
+			//k way merge of the matched buckets: highest priority first, insertion order among equals
+			int best = -1;
+			for (uint i = 0; i < count; i++)
+			{
+				std::vector<BucketEntry>& bucket = _buckets[matched[i]];
+				while (cursor[i] < bucket.size() && !isEntryValid(bucket[cursor[i]]))
+					cursor[i]++;
+				if (cursor[i] >= bucket.size())
+					continue;
+				const EventHandlerInfo& a = _slots[bucket[cursor[i]].slot].listener;
+				//a masking listener hides lower priority listeners of its own type
+				if (maskPriority[i] > a.priority)
 				{
-					KeyEventInfo* ef = new KeyEventInfo();
-					for (auto k : _heldKeys) {
-						ef->timeStamp = SDL_GetTicks();
-						ef->type = EventType::key_hold;
-						ef->keyCode = k;
-						ef->state = 3;
-						ef->heldKeys = _heldKeys;
-						Keyboard = *ef;
-						listener.handler(ef);
-					}
-					delete ef;
+					cursor[i] = bucket.size();
+					continue;
 				}
-					break;
-				case EventType::mouse_move:
-				case EventType::mouse_down:
-				case EventType::mouse_up:
-				case EventType::mouse_down_left:
-				case EventType::mouse_down_middle:
-				case EventType::mouse_down_right:
-				case EventType::mouse_up_left:
-				case EventType::mouse_up_middle:
-				case EventType::mouse_up_right:
+				if (best < 0)
 				{
-					Mouse.type = listener.type;
-					Mouse.timeStamp = SDL_GetTicks();
-					listener.handler(&Mouse);
+					best = (int)i;
+					continue;
 				}
-				break;
-				default:
-					break;
-				}
-				
+				const EventHandlerInfo& b = _slots[_buckets[matched[best]][cursor[best]].slot].listener;
+				if (a.priority > b.priority || (a.priority == b.priority && a.sequence < b.sequence))
+					best = (int)i;
 			}
+			if (best < 0)
+				break;
+
+			uint slot = _buckets[matched[best]][cursor[best]].slot;
+			cursor[best]++;
+			dispatch(_slots[slot].listener, timeStamp);
+			if (_slots[slot].alive && _slots[slot].listener.mask)
+				maskPriority[best] = _slots[slot].listener.priority;
+		}
+		_dispatching = false;
 
-			if (listener.mask == true){
-				mask_flags[listener.type] = true;
-				priority_flags[listener.type] = listener.priority;
+		//slots freed by handlers were kept intact while they could still be running
+		for (uint slot : _releasedSlots)
+		{
+			_slots[slot].listener.handler = nullptr;
+			_freeSlots.push_back(slot);
+		}
+		_releasedSlots.clear();
+		compactBuckets();
+		for (uint slot : _deferredInserts)
+		{
+			_slots[slot].insert_pending = false;
+			if (_slots[slot].alive)
+				insertEntry(slot);
+		}
+		_deferredInserts.clear();
+		LatencyTracker::markResolved();
+	}
+
+	void EventSystem::dispatch(EventHandlerInfo& listener, uint timeStamp)
+	{
+		switch (listener.type)
+		{
+		case EventType::key_down:
+			for (auto k : _pressedKeys) {
+				Keyboard.timeStamp = timeStamp;
+				Keyboard.type = EventType::key_down;
+				Keyboard.keyCode = k;
+				Keyboard.state = 1;
+				listener.handler(&Keyboard);
+			}
+			break;
+		case EventType::key_up:
+			for (auto k : _releasedKeys) {
+				Keyboard.timeStamp = timeStamp;
+				Keyboard.type = EventType::key_up;
+				Keyboard.keyCode = k;
+				Keyboard.state = 2;
+				listener.handler(&Keyboard);
 			}
+			break;
+		case EventType::key_hold:
+			for (auto k : _heldKeys) {
+				Keyboard.timeStamp = timeStamp;
+				Keyboard.type = EventType::key_hold;
+				Keyboard.keyCode = k;
+				Keyboard.state = 3;
+				listener.handler(&Keyboard);
+			}
+			break;
+		case EventType::mouse_move:
+		case EventType::mouse_wheel:
+		case EventType::mouse_down:
+		case EventType::mouse_up:
+		case EventType::mouse_down_left:
+		case EventType::mouse_down_middle:
+		case EventType::mouse_down_right:
+		case EventType::mouse_up_left:
+		case EventType::mouse_up_middle:
+		case EventType::mouse_up_right:
+			Mouse.type = listener.type;
+			Mouse.timeStamp = timeStamp;
+			listener.handler(&Mouse);
+			break;
+		default:
+			break;
 		}
 	}
 
@@ -211,93 +370,170 @@ namespace sp {
 	}
 
 
-	EventHandlerInfo EventSystem::addEventListener(EventType ev, std::function<void(EventInfo *)> handler, bool mask, uint id, byte priority)
+	EventHandlerInfo EventSystem::addEventListener(EventType ev, std::function<void(EventInfo *)> handler, bool mask, byte priority)
 	{
-		id = getValidId(id);
+		if (getBucket(ev) < 0)
+		{
+			Logger::warn(LogCategory::input, "addEventListener: unknown event type {}, listener not added", static_cast<uint>(ev));
+			return EventHandlerInfo();
+		}
+		uint index;
+		if (!_freeSlots.empty())
+		{
+			index = _freeSlots.back();
+			_freeSlots.pop_back();
+		}
+		else
+		{
+			index = (uint)_slots.size();
+			if (index > cnst_listener_index_mask)
+			{
+				Logger::warn(LogCategory::input, "addEventListener: too many event listeners, listener not added");
+				return EventHandlerInfo();
+			}
+			_slots.push_back(ListenerSlot());
+		}
+		ListenerSlot& slot = _slots[index];
+		slot.alive = true;
 
-		EventHandlerInfo evnt;
-		evnt.id = id;
+		EventHandlerInfo& evnt = slot.listener;
+		evnt.id = (slot.generation << cnst_listener_index_bits) | index;
 		evnt.type = ev;
 		evnt.handler = handler;
 		evnt.mask = mask;
 		evnt.priority = priority;
+		evnt.sequence = _sequence++;
 
-		_events.push_back(evnt);
-		std::sort(_events.begin(), _events.end(), [](auto a, auto b) {
-			return a.priority > b.priority;
-		});
+		queueInsert(index);
 		return evnt;
 
 	}
 
 	void EventSystem::removeEventListener(uint id)
 	{
-		for (int i = 0; i < _events.size(); i++)
+		ListenerSlot* slot = findSlot(id);
+		if (slot == nullptr)
+			return;
+		uint index = id & cnst_listener_index_mask;
+		//its bucket entry goes stale, a new generation invalidates the old id
+		slot->alive = false;
+		slot->stamp++;
+		slot->generation = (slot->generation + 1) & (~0u >> cnst_listener_index_bits);
+		if (slot->generation == 0)
+			slot->generation = 1;
+		_staleEntries[getBucket(slot->listener.type)]++;
+		if (_dispatching)
+			_releasedSlots.push_back(index);
+		else
 		{
-			if (_events[i].id == id)
-			{
-				_events[i] = _events[_events.size() - 1];
-				_events.pop_back();
-				break;
-			}
+			slot->listener.handler = nullptr;
+			_freeSlots.push_back(index);
 		}
-		std::sort(_events.begin(), _events.end(), [](auto a, auto b) {
-			return a.priority > b.priority;
-			});
 	}
 
 	byte EventSystem::getListenerPriority(int id)
 	{
-		byte priority = 0;
-		for (int i = 0; i < _events.size(); i++)
-		{
-			if (_events[i].id == id)
-			{
-				priority = _events[i].priority;
-				break;
-			}
-		}
-		return priority;
+		ListenerSlot* slot = findSlot(id);
+		return slot ? slot->listener.priority : 0;
 	}
 
 	bool EventSystem::getListenerMask(int id)
 	{
-		bool mask = false;
-		for (int i = 0; i < _events.size(); i++)
+		ListenerSlot* slot = findSlot(id);
+		return slot ? slot->listener.mask : false;
+	}
+
+	void EventSystem::setListenerPriority(int id, byte priority)
+	{
+		ListenerSlot* slot = findSlot(id);
+		if (slot == nullptr || slot->listener.priority == priority)
+			return;
+		//old entry goes stale, a new one is inserted at the new place keeping insertion order
+		slot->listener.priority = priority;
+		slot->stamp++;
+		_staleEntries[getBucket(slot->listener.type)]++;
+		queueInsert(id & cnst_listener_index_mask);
+	}
+
+	void EventSystem::setListenerMask(int id, bool mask)
+	{
+		ListenerSlot* slot = findSlot(id);
+		if (slot != nullptr)
+			slot->listener.mask = mask;
+	}
+
+	int EventSystem::getBucket(EventType type)
+	{
+		for (uint b = 0; b < cnst_event_bucket_count; b++)
 		{
-			if (_events[i].id == id)
-			{
-				mask = _events[i].mask;
-				break;
-			}
+			if (cnst_bucket_types[b] == type)
+				return (int)b;
 		}
-		return mask;
+		return -1;
 	}
 
-	void EventSystem::setListenerPriority(int id, byte priority)
+	bool EventSystem::isEntryValid(const BucketEntry& entry)
+	{
+		const ListenerSlot& slot = _slots[entry.slot];
+		return slot.alive && slot.stamp == entry.stamp;
+	}
+
+	void EventSystem::insertEntry(uint slot)
 	{
-		for (int i = 0; i < _events.size(); i++)
+		const EventHandlerInfo& listener = _slots[slot].listener;
+		int b = getBucket(listener.type);
+		std::vector<BucketEntry>& bucket = _buckets[b];
+		//stale entries would break the binary search, drop them first
+		if (_staleEntries[b] > 0)
+			compactBucket(b);
+		auto it = std::upper_bound(bucket.begin(), bucket.end(), listener, [](const EventHandlerInfo& a, const BucketEntry& e) {
+			const EventHandlerInfo& b = _slots[e.slot].listener;
+			return a.priority > b.priority || (a.priority == b.priority && a.sequence < b.sequence);
+		});
+		bucket.insert(it, { slot, _slots[slot].stamp });
+	}
+
+	void EventSystem::queueInsert(uint slot)
+	{
+		if (!_dispatching)
 		{
-			if (_events[i].id == id)
-			{
-				_events[i].priority = priority;
-				break;
-			}
+			insertEntry(slot);
+			return;
 		}
+		//the entry is built from the slot's state after the dispatch, one insert covers every change
+		if (_slots[slot].insert_pending)
+			return;
+		_slots[slot].insert_pending = true;
+		_deferredInserts.push_back(slot);
 	}
 
-	void EventSystem::setListenerMask(int id, bool mask)
+	void EventSystem::compactBucket(uint b)
 	{
-		for (int i = 0; i < _events.size(); i++)
+		std::vector<BucketEntry>& bucket = _buckets[b];
+		bucket.erase(std::remove_if(bucket.begin(), bucket.end(), [](const BucketEntry& e) { return !isEntryValid(e); }), bucket.end());
+		_staleEntries[b] = 0;
+	}
+
+	void EventSystem::compactBuckets()
+	{
+		for (uint b = 0; b < cnst_event_bucket_count; b++)
 		{
-			if (_events[i].id == id)
-			{
-				_events[i].mask = mask;
-				break;
-			}
+			if (_staleEntries[b] > 0)
+				compactBucket(b);
 		}
 	}
 
+	EventSystem::ListenerSlot* EventSystem::findSlot(uint id)
+	{
+		uint index = id & cnst_listener_index_mask;
+		if (index >= _slots.size())
+			return nullptr;
+		ListenerSlot& slot = _slots[index];
+		if (!slot.alive || slot.generation != (id >> cnst_listener_index_bits))
+			return nullptr;
+		return &slot;
+	}
+
 	MouseEventInfo EventSystem::getMouse(EventInfo* info)
 	{
 		MouseEventInfo ef = *(static_cast<MouseEventInfo *>(info));
@@ -328,47 +564,28 @@ namespace sp {
 
 	bool EventSystem::isHoldingKey(KeyCode code)
 	{
-		auto it = std::find(_heldKeys.begin(), _heldKeys.end(), code);
-		return (it != _heldKeys.end());
+		return _heldState.test(getKeyIndex(code));
 	}
 
 	bool EventSystem::isPressedKey(KeyCode code)
 	{
-		auto it = std::find(_pressedKeys.begin(), _pressedKeys.end(), code);
-		return (it != _pressedKeys.end());
+		return _pressedState.test(getKeyIndex(code));
 	}
 
 	bool EventSystem::isReleasedKey(KeyCode code)
 	{
-		auto it = std::find(_releasedKeys.begin(), _releasedKeys.end(), code);
-		return (it != _releasedKeys.end());
+		return _releasedState.test(getKeyIndex(code));
 	}
 
-
-
-	int EventSystem::getValidId(int id)
+	uint EventSystem::getKeyIndex(KeyCode code)
 	{
-		bool is_present = false;
-		if (id == 0)
-			is_present = true;
-		else
-			for (auto ev : _events)
-			{
-				if (ev.id == id)
-				{
-					is_present = true;
-					break;
-				}
-			}
-
-		if (!is_present) {
-			return id;
-		}
-		else {
-			int new_id = rand();
-			return getValidId(new_id);
-		}
-
+		//sdl keycodes are either characters or scancode | (1 << 30)
+		uint value = static_cast<uint>(code);
+		if (value & 0x40000000)
+			return 128 + (value & 0x1FF);
+		if (value < 128)
+			return value;
+		return 0; // non ascii characters share the unknown key
 	}
 
 	bool EventSystem::matchSequence(uint expression, uint sequence)
@@ -1,6 +1,8 @@
 #pragma once
 #include "api.h"
 #include <algorithm>
+#include <cstdint>
+#include <deque>
 #include <functional>
 #include <vector>
 
@@ -157,6 +159,32 @@ namespace sp {
 		alt_right = 0x400000E6,
 	};
 
+	//kinds of window input the event system consumes
+	enum class RawInputType : uint8_t
+	{
+		quit = 0,
+		key_down,
+		key_up,
+		mouse_move,
+		mouse_button_down,
+		mouse_button_up,
+		mouse_wheel,
+	};
+
+	//compact copy of one polled window event, fixed size so it can be recorded and replayed as is
+	struct SP_API RawInputEvent
+	{
+		RawInputType type = RawInputType::quit;
+		uint8_t button = 0; // 1 left 2 middle 3 right (sdl numbering)
+		uint16_t reserved = 0;
+		int32_t key = 0; // KeyCode value
+		int32_t x = 0; // screen position or wheel amount
+		int32_t y = 0;
+		int32_t dx = 0;
+		int32_t dy = 0;
+		uint64_t time_ns = 0; // Clock time the window received it, 0 when unknown (replayed)
+	};
+
 	
 	//base ckass for event information
 	struct SP_API EventInfo
@@ -166,6 +194,7 @@ namespace sp {
 
 	};
 	//structure containing mouse event info
+	//position is the latest of the frame, deltas and wheel are summed over all motion of the frame
 	struct SP_API MouseEventInfo: public EventInfo
 	{
 		real x = 0.0f;
@@ -174,6 +203,17 @@ namespace sp {
 		real dy = 0.0f;
 		int screenX = 0;
 		int screenY = 0;
+		int wheelX = 0;
+		int wheelY = 0;
+	};
+
+	//one raw motion event inside a frame, see EventSystem::setMouseHistory()
+	struct SP_API MouseSample
+	{
+		int screenX = 0;
+		int screenY = 0;
+		int dx = 0;
+		int dy = 0;
 	};
 
 	//structure containing keyboard event info
@@ -188,16 +228,42 @@ namespace sp {
 		}
 	};
 
+	const uint cnst_key_state_bits = 640; // 128 ascii keycodes + 512 sdl scancode keycodes
+
+	//fixed size set of keys, indexed by EventSystem::getKeyIndex()
+	struct SP_API KeyBitset
+	{
+		uint64_t words[cnst_key_state_bits / 64] = {};
+
+		bool test(uint index) const { return (words[index >> 6] >> (index & 63)) & 1; }
+		void set(uint index) { words[index >> 6] |= uint64_t(1) << (index & 63); }
+		void reset(uint index) { words[index >> 6] &= ~(uint64_t(1) << (index & 63)); }
+		void clear()
+		{
+			for (uint64_t& w : words)
+				w = 0;
+		}
+	};
+
+	//listener ids are slot map handles: slot index in the low bits, slot generation in the high bits
+	//a removed listener's id stops matching once its slot is reused; the generation has 32 - cnst_listener_index_bits
+	//bits, so a stale id only aliases a new listener after its slot was reused 4095 more times
+	const uint cnst_listener_index_bits = 20;
+	const uint cnst_listener_index_mask = (1u << cnst_listener_index_bits) - 1;
+
 	//structure containing information about a window Event
 	struct SP_API EventHandlerInfo
 	{
-		uint id = 0;
+		uint id = 0; // handle returned by EventSystem::addEventListener
 		EventType type = EventType::none;
 		std::function<void(EventInfo *)> handler;
 		byte priority = 20;
 		bool mask = false; // if true no other event after this should be executed
+		uint sequence = 0; // insertion order, keeps listeners of equal priority stable
 	};
 
+	const uint cnst_event_bucket_count = 15; // one dispatch bucket per EventType
+
 	//singletone class for translating and handling events
 	class SP_API EventSystem 
 	{
@@ -207,19 +273,56 @@ namespace sp {
 	private:
 		static bool _shouldQuit;
 		static uint _controlWord;
-		static std::vector<EventHandlerInfo> _events;
+		struct ListenerSlot
+		{
+			EventHandlerInfo listener;
+			uint generation = 1;
+			uint stamp = 0; // bumped when the bucket entry is rebuilt, older entries become stale
+			bool alive = false;
+			bool insert_pending = false; // already queued in _deferredInserts
+		};
+		//bucket entries go stale instead of being erased, resolve() compacts them
+		struct BucketEntry
+		{
+			uint slot;
+			uint stamp;
+		};
+		static std::deque<ListenerSlot> _slots; // deque so slots never move while a handler runs
+		static std::vector<uint> _freeSlots;
+		static std::vector<uint> _releasedSlots; // freed during dispatch, reusable after it
+		//listeners grouped by type, each bucket sorted by priority (high first) then insertion order
+		static std::vector<BucketEntry> _buckets[cnst_event_bucket_count];
+		static uint _staleEntries[cnst_event_bucket_count];
+		static uint _sequence;
+		static bool _dispatching;
+		static std::vector<uint> _deferredInserts; // slots added or re-prioritized during dispatch
+
+		//ordered lists drive dispatch, bitsets answer queries
 		static std::vector<KeyCode> _pressedKeys;
 		static std::vector<KeyCode> _releasedKeys;
 		static std::vector<KeyCode> _heldKeys;
+		static KeyBitset _pressedState; // edges of the current input frame
+		static KeyBitset _releasedState;
+		static KeyBitset _heldState;
+		static bool _recordMouseHistory;
+		static std::vector<MouseSample> _mouseHistory;
 
 	public:
 		static void resetControlWord();
 		static void addControlWord(uint word);
 		static void pollFromWindow(void * window);
+		static void injectEvents(const std::vector<RawInputEvent>& events); // starts a new input frame with these events, used by replay
 		static void resolve();
 		static bool shouldQuit();
+		static void requestQuit() { _shouldQuit = true; }
 		
-		static EventHandlerInfo addEventListener(EventType ev, std::function<void(EventInfo*)> handler, bool mask = true, uint id = 0, byte priority = 10);
+		//the id of the returned info is the only valid handle, a literal priority has to be passed as byte(n)
+		static EventHandlerInfo addEventListener(EventType ev, std::function<void(EventInfo*)> handler, bool mask = true, byte priority = 10);
+		//old (mask, id) form, the fourth argument could be taken for a priority so it does not compile
+		template<typename T>
+		static EventHandlerInfo addEventListener(EventType ev, std::function<void(EventInfo*)> handler, bool mask, T id) = delete;
+		[[deprecated("the id is ignored, drop it")]]
+		static EventHandlerInfo addEventListener(EventType ev, std::function<void(EventInfo*)> handler, bool mask, uint id, byte priority) { return addEventListener(ev, handler, mask, priority); }
 		static void removeEventListener(uint id);
 		static byte getListenerPriority(int id);
 		static bool getListenerMask(int id);
@@ -236,9 +339,25 @@ namespace sp {
 		static bool isPressedKey(KeyCode code);
 		static bool isReleasedKey(KeyCode code);
 
+		//off by default, when on every motion event of the frame is kept for stroke drawing etc.
+		static void setMouseHistory(bool record) { _recordMouseHistory = record; _mouseHistory.clear(); }
+		static const std::vector<MouseSample>& getMouseHistory() { return _mouseHistory; } // this frame, oldest first
+		//sums relative motion still waiting in the sdl queue without consuming it (late latching)
+		//false when there is none, or when input is replayed or there is no window
+		static bool peekMouseMotion(float& dx, float& dy);
+		static uint getKeyIndex(KeyCode code); // dense index into cnst_key_state_bits
+
 
 	private:
-		static int getValidId(int id);
+		static void applyRawEvent(const RawInputEvent& ev);
+		static void dispatch(EventHandlerInfo& listener, uint timeStamp);
+		static int getBucket(EventType type);
+		static bool isEntryValid(const BucketEntry& entry);
+		static void insertEntry(uint slot);
+		static void queueInsert(uint slot); // inserts now, or once after the dispatch
+		static void compactBucket(uint bucket);
+		static void compactBuckets();
+		static ListenerSlot* findSlot(uint id);
 		static bool matchSequence(uint expression, uint sequence);
 	};
 
@@ -0,0 +1,95 @@
+#include "inputQueue.h"
+#include <atomic>
+#include <cstring>
+
+namespace sp {
+
+	const uint cnst_input_event_words = sizeof(TimedInputEvent) / sizeof(uint64_t);
+	static_assert(sizeof(TimedInputEvent) % sizeof(uint64_t) == 0, "TimedInputEvent must be a whole number of words");
+
+	//payload is stored as relaxed atomic words so a torn read is detected by the sequence, not undefined behaviour
+	struct InputSlot
+	{
+		std::atomic<uint64_t> sequence{ 0 }; // 2n+1 while event n is written, 2n+2 once complete
+		std::atomic<uint64_t> words[cnst_input_event_words];
+	};
+
+	static InputSlot s_slots[cnst_input_queue_size];
+	static std::atomic<uint64_t> s_head{ 0 };
+
+	void InputQueue::publish(const TimedInputEvent& ev)
+	{
+		uint64_t n = s_head.load(std::memory_order_relaxed);
+		InputSlot& slot = s_slots[n & (cnst_input_queue_size - 1)];
+		uint64_t words[cnst_input_event_words];
+		std::memcpy(words, &ev, sizeof(TimedInputEvent));
+
+		slot.sequence.store(2 * n + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		for (uint i = 0; i < cnst_input_event_words; i++)
+			slot.words[i].store(words[i], std::memory_order_relaxed);
+		slot.sequence.store(2 * n + 2, std::memory_order_release);
+		s_head.store(n + 1, std::memory_order_release);
+	}
+
+	uint64_t InputQueue::getHead()
+	{
+		return s_head.load(std::memory_order_acquire);
+	}
+
+	bool InputQueue::read(uint64_t index, TimedInputEvent& out)
+	{
+		InputSlot& slot = s_slots[index & (cnst_input_queue_size - 1)];
+		uint64_t expected = 2 * index + 2;
+		if (slot.sequence.load(std::memory_order_acquire) != expected)
+			return false;
+		uint64_t words[cnst_input_event_words];
+		for (uint i = 0; i < cnst_input_event_words; i++)
+			words[i] = slot.words[i].load(std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (slot.sequence.load(std::memory_order_relaxed) != expected)
+			return false;
+		std::memcpy(&out, words, sizeof(TimedInputEvent));
+		return true;
+	}
+
+
+	InputSubscriber::InputSubscriber()
+		:_cursor(InputQueue::getHead())
+	{
+	}
+
+	bool InputSubscriber::poll(TimedInputEvent& out)
+	{
+		while (true)
+		{
+			uint64_t head = InputQueue::getHead();
+			if (_cursor >= head)
+				return false;
+			if (head - _cursor > cnst_input_queue_size)
+			{
+				//lapped, the oldest events are gone
+				_missed += head - cnst_input_queue_size - _cursor;
+				_cursor = head - cnst_input_queue_size;
+			}
+			if (!InputQueue::read(_cursor, out))
+				continue; // overwritten while reading, head has moved on
+			_cursor++;
+
+			KeyCode key = static_cast<KeyCode>(out.event.key);
+			if (out.event.type == RawInputType::key_down)
+				_held.set(EventSystem::getKeyIndex(key));
+			else if (out.event.type == RawInputType::key_up)
+				_held.reset(EventSystem::getKeyIndex(key));
+			return true;
+		}
+	}
+
+	void InputSubscriber::skipToLatest()
+	{
+		TimedInputEvent ev;
+		//still walk the events so the key state stays right
+		while (poll(ev)) {}
+	}
+
+};
@@ -0,0 +1,46 @@
+#pragma once
+#include "api.h"
+#include "eventSystem.h"
+#include <cstdint>
+
+namespace sp {
+
+	const uint cnst_input_queue_size = 4096; // events kept for slow subscribers, power of two
+
+	//raw input event stamped with the Clock time the window received it, replayed events with the time they were injected
+	struct SP_API TimedInputEvent
+	{
+		uint64_t time_ns = 0;
+		RawInputEvent event;
+	};
+
+	//broadcast ring of every input event EventSystem receives, live or replayed
+	//one producer (the thread running EventSystem, normally main), any number of readers
+	//readers never block the producer: slots are seqlocked and a reader that falls a full ring behind skips ahead
+	class SP_API InputQueue
+	{
+	public:
+		static void publish(const TimedInputEvent& ev); // producer only
+		static uint64_t getHead(); // number of events published so far
+		static bool read(uint64_t index, TimedInputEvent& out); // false if the slot was overwritten
+	};
+
+	//per thread reader of InputQueue with its own cursor and key state
+	//use it from fastUpdate or any worker instead of the EventSystem statics, which belong to the main thread
+	class SP_API InputSubscriber
+	{
+	private:
+		uint64_t _cursor;
+		uint64_t _missed = 0;
+		KeyBitset _held;
+	public:
+		InputSubscriber(); // starts at the newest event, history is not replayed
+
+		bool poll(TimedInputEvent& out); // next event, false once caught up
+		void skipToLatest();
+		uint64_t getMissedCount() const { return _missed; } // events lost because this reader lagged a full ring
+
+		bool isHoldingKey(KeyCode code) const { return _held.test(EventSystem::getKeyIndex(code)); } // as of the last polled event
+	};
+
+};
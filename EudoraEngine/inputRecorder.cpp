@@ -0,0 +1,138 @@
+#include "inputRecorder.h"
+#include "control/logger.h"
+#include <cstring>
+#include <fstream>
+
+namespace sp {
+
+	const char cnst_input_stream_magic[4] = { 'S', 'P', 'I', 'R' };
+	const uint32_t cnst_input_stream_version = 2; // 2: events carry their receive time
+
+	static std::ofstream s_recordFile;
+
+	bool InputRecorder::_recording = false;
+	bool InputRecorder::_replaying = false;
+	std::vector<RawInputEvent> InputRecorder::_pendingEvents = {};
+	std::vector<uint8_t> InputRecorder::_replayData = {};
+	size_t InputRecorder::_replayOffset = 0;
+	uint64_t InputRecorder::_replayFrameTime = 0;
+	uint InputRecorder::_replayFrame = 0;
+
+	bool InputRecorder::startRecording(std::string path)
+	{
+		stopRecording();
+		s_recordFile.open(path, std::ios::binary | std::ios::trunc);
+		if (!s_recordFile.is_open())
+		{
+			Logger::warn(LogCategory::input, "cannot open input recording {} for writing", path);
+			return false;
+		}
+		s_recordFile.write(cnst_input_stream_magic, 4);
+		s_recordFile.write(reinterpret_cast<const char*>(&cnst_input_stream_version), sizeof(uint32_t));
+		_pendingEvents.clear();
+		_recording = true;
+		return true;
+	}
+
+	void InputRecorder::stopRecording()
+	{
+		if (!_recording)
+			return;
+		_recording = false;
+		s_recordFile.close();
+	}
+
+	bool InputRecorder::startReplay(std::string path)
+	{
+		stopReplay();
+		std::ifstream file(path, std::ios::binary | std::ios::ate);
+		if (!file.is_open())
+		{
+			Logger::warn(LogCategory::input, "cannot open input recording {}", path);
+			return false;
+		}
+		size_t size = (size_t)file.tellg();
+		file.seekg(0);
+		_replayData.resize(size);
+		if (size > 0)
+			file.read(reinterpret_cast<char*>(&_replayData[0]), size);
+
+		uint32_t version = 0;
+		if (size < 8 || std::memcmp(&_replayData[0], cnst_input_stream_magic, 4) != 0)
+		{
+			Logger::warn(LogCategory::input, "{} is not an input recording", path);
+			_replayData.clear();
+			return false;
+		}
+		std::memcpy(&version, &_replayData[4], sizeof(uint32_t));
+		if (version != cnst_input_stream_version)
+		{
+			Logger::warn(LogCategory::input, "unsupported input recording version {}", version);
+			_replayData.clear();
+			return false;
+		}
+		_replayOffset = 8;
+		_replayFrame = 0;
+		_replayFrameTime = 0;
+		_replaying = true;
+		return true;
+	}
+
+	void InputRecorder::stopReplay()
+	{
+		_replaying = false;
+		_replayData.clear();
+		_replayOffset = 0;
+	}
+
+	void InputRecorder::captureEvents(const std::vector<RawInputEvent>& events)
+	{
+		if (_recording)
+			_pendingEvents.insert(_pendingEvents.end(), events.begin(), events.end());
+	}
+
+	void InputRecorder::commitFrame(uint64_t frameTime_ns)
+	{
+		if (!_recording)
+			return;
+		uint32_t count = (uint32_t)_pendingEvents.size();
+		s_recordFile.write(reinterpret_cast<const char*>(&frameTime_ns), sizeof(uint64_t));
+		s_recordFile.write(reinterpret_cast<const char*>(&count), sizeof(uint32_t));
+		if (count > 0)
+			s_recordFile.write(reinterpret_cast<const char*>(&_pendingEvents[0]), count * sizeof(RawInputEvent));
+		_pendingEvents.clear();
+	}
+
+	bool InputRecorder::nextReplayFrame(std::vector<RawInputEvent>& events)
+	{
+		events.clear();
+		if (!_replaying)
+			return false;
+		const size_t header = sizeof(uint64_t) + sizeof(uint32_t);
+		if (_replayOffset + header > _replayData.size())
+		{
+			stopReplay();
+			return false;
+		}
+		uint32_t count = 0;
+		std::memcpy(&_replayFrameTime, &_replayData[_replayOffset], sizeof(uint64_t));
+		std::memcpy(&count, &_replayData[_replayOffset + sizeof(uint64_t)], sizeof(uint32_t));
+		_replayOffset += header;
+		if (_replayOffset + count * sizeof(RawInputEvent) > _replayData.size())
+		{
+			Logger::warn(LogCategory::input, "input recording is truncated at frame {}, replay stopped", _replayFrame);
+			stopReplay();
+			return false;
+		}
+		events.resize(count);
+		if (count > 0)
+			std::memcpy(&events[0], &_replayData[_replayOffset], count * sizeof(RawInputEvent));
+		//recorded receive times belong to the recording session
+		for (RawInputEvent& ev : events)
+			ev.time_ns = 0;
+		_replayOffset += count * sizeof(RawInputEvent);
+		_replayFrame++;
+		return true;
+	}
+
+};
@@ -0,0 +1,41 @@
+#pragma once
+#include "api.h"
+#include "eventSystem.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace sp {
+
+	//records polled input and frame times into a compact binary stream and plays them back in place of sdl
+	//file: "SPIR" + version, then per frame: frame time in ns (u64), event count (u32), RawInputEvent[count]
+	//a replay feeds the recorded frame times to Application, so fixed updates and dt are identical run to run
+	//replay ignores the wall clock, it runs as fast as the frame limiter allows (uncapped by default)
+	class SP_API InputRecorder
+	{
+	private:
+		static bool _recording;
+		static bool _replaying;
+		static std::vector<RawInputEvent> _pendingEvents; // polled this frame, written with its frame time
+		static std::vector<uint8_t> _replayData;
+		static size_t _replayOffset;
+		static uint64_t _replayFrameTime; // ns
+		static uint _replayFrame;
+	public:
+		static bool startRecording(std::string path);
+		static void stopRecording();
+		static bool startReplay(std::string path); // loads the whole stream in memory
+		static void stopReplay();
+
+		static bool isRecording() { return _recording; }
+		static bool isReplaying() { return _replaying; }
+		static uint getReplayFrame() { return _replayFrame; }
+
+		//hooks used by EventSystem and Application
+		static void captureEvents(const std::vector<RawInputEvent>& events);
+		static void commitFrame(uint64_t frameTime_ns);
+		static bool nextReplayFrame(std::vector<RawInputEvent>& events); // false once the stream ends
+		static uint64_t getReplayFrameTime() { return _replayFrameTime; }
+	};
+
+};
@@ -0,0 +1,211 @@
+#include "clusteredLights.h"
+#include "renderStats.h"
+#include "../application.h"
+#include "../control/jobSystem.h"
+#include "../control/profiler.h"
+#include "../deps/glad.h"
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE__)
+#define SP_CLUSTER_SSE
+#include <xmmintrin.h>
+#endif
+
+namespace sp {
+
+	//padding lanes get an inverted box that no sphere can touch
+	const float cnst_cluster_empty = 1e30f;
+
+	//std140 mirror of sp_clusters
+	struct ClusterParams
+	{
+		uint grid[4];
+		float depth[4];
+		float screen[4];
+	};
+
+	LightClusterGrid::LightClusterGrid(uint tiles_x, uint tiles_y, uint slices)
+		:_tilesX(tiles_x),
+		_tilesY(tiles_y),
+		_slices(slices)
+	{
+		_rowStride = (_tilesX * _tilesY + 3) & ~3u;
+		_clusterLights.resize(getClusterCount());
+		glGenBuffers(1, &_lightBuffer);
+		glGenBuffers(1, &_rangeBuffer);
+		glGenBuffers(1, &_indexBuffer);
+		_params = new UniformBuffer(sizeof(ClusterParams), cnst_cluster_ubo_binding);
+	}
+
+	LightClusterGrid::~LightClusterGrid()
+	{
+		glDeleteBuffers(1, &_lightBuffer);
+		glDeleteBuffers(1, &_rangeBuffer);
+		glDeleteBuffers(1, &_indexBuffer);
+		delete _params;
+	}
+
+	void LightClusterGrid::buildClusterBounds(const glm::mat4& projection)
+	{
+		_projection = projection;
+		//near and far of a gl perspective matrix
+		_near = projection[3][2] / (projection[2][2] - 1.0f);
+		_far = projection[3][2] / (projection[2][2] + 1.0f);
+		glm::mat4 inverse = glm::inverse(projection);
+
+		uint size = _rowStride * _slices;
+		_minX.assign(size, cnst_cluster_empty); _minY.assign(size, cnst_cluster_empty); _minZ.assign(size, cnst_cluster_empty);
+		_maxX.assign(size, -cnst_cluster_empty); _maxY.assign(size, -cnst_cluster_empty); _maxZ.assign(size, -cnst_cluster_empty);
+		for (uint s = 0; s < _slices; s++)
+		{
+			float depths[2] = {
+				_near * std::pow(_far / _near, float(s) / _slices),
+				_near * std::pow(_far / _near, float(s + 1) / _slices) };
+			for (uint y = 0; y < _tilesY; y++)
+			{
+				for (uint x = 0; x < _tilesX; x++)
+				{
+					uint i = s * _rowStride + y * _tilesX + x;
+					for (uint corner = 0; corner < 4; corner++)
+					{
+						float nx = -1.0f + 2.0f * float(x + (corner & 1)) / _tilesX;
+						float ny = -1.0f + 2.0f * float(y + (corner >> 1)) / _tilesY;
+						//ray from the eye through the corner on the near plane, cut at both slice depths
+						glm::vec4 p = inverse * glm::vec4(nx, ny, -1.0f, 1.0f);
+						glm::vec3 ray = glm::vec3(p) / p.w;
+						for (float depth : depths)
+						{
+							glm::vec3 q = ray * (depth / -ray.z);
+							_minX[i] = std::min(_minX[i], q.x); _maxX[i] = std::max(_maxX[i], q.x);
+							_minY[i] = std::min(_minY[i], q.y); _maxY[i] = std::max(_maxY[i], q.y);
+							_minZ[i] = std::min(_minZ[i], q.z); _maxZ[i] = std::max(_maxZ[i], q.z);
+						}
+					}
+				}
+			}
+		}
+	}
+
+	void LightClusterGrid::binSlice(uint slice, const std::vector<glm::vec4>& view_lights)
+	{
+		uint tiles = _tilesX * _tilesY;
+		uint first = slice * tiles;
+		for (uint t = 0; t < tiles; t++)
+			_clusterLights[first + t].clear();
+
+		float slice_near = _near * std::pow(_far / _near, float(slice) / _slices);
+		float slice_far = _near * std::pow(_far / _near, float(slice + 1) / _slices);
+		const uint row = slice * _rowStride;
+		for (uint l = 0; l < view_lights.size(); l++)
+		{
+			const glm::vec4& light = view_lights[l];
+			float depth = -light.z;
+			if (depth + light.w < slice_near || depth - light.w > slice_far)
+				continue;
+#ifdef SP_CLUSTER_SSE
+			__m128 cx = _mm_set1_ps(light.x), cy = _mm_set1_ps(light.y), cz = _mm_set1_ps(light.z);
+			__m128 r2 = _mm_set1_ps(light.w * light.w);
+			__m128 zero = _mm_setzero_ps();
+			for (uint t = 0; t < tiles; t += 4)
+			{
+				uint i = row + t;
+				//distance from the sphere center to each box, four clusters at a time
+				__m128 dx = _mm_add_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&_minX[i]), cx), zero), _mm_max_ps(_mm_sub_ps(cx, _mm_loadu_ps(&_maxX[i])), zero));
+				__m128 dy = _mm_add_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&_minY[i]), cy), zero), _mm_max_ps(_mm_sub_ps(cy, _mm_loadu_ps(&_maxY[i])), zero));
+				__m128 dz = _mm_add_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&_minZ[i]), cz), zero), _mm_max_ps(_mm_sub_ps(cz, _mm_loadu_ps(&_maxZ[i])), zero));
+				__m128 d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+				int mask = _mm_movemask_ps(_mm_cmple_ps(d2, r2));
+				while (mask)
+				{
+					uint lane = 0;
+					while (!(mask & (1 << lane))) lane++;
+					mask &= ~(1 << lane);
+					_clusterLights[first + t + lane].push_back(l);
+				}
+			}
+#else
+			for (uint t = 0; t < tiles; t++)
+			{
+				uint i = row + t;
+				float dx = std::max(_minX[i] - light.x, 0.0f) + std::max(light.x - _maxX[i], 0.0f);
+				float dy = std::max(_minY[i] - light.y, 0.0f) + std::max(light.y - _maxY[i], 0.0f);
+				float dz = std::max(_minZ[i] - light.z, 0.0f) + std::max(light.z - _maxZ[i], 0.0f);
+				if (dx * dx + dy * dy + dz * dz <= light.w * light.w)
+					_clusterLights[first + t].push_back(l);
+			}
+#endif
+		}
+	}
+
+	void LightClusterGrid::update(Camera& camera, const std::vector<PointLight>& lights, uint screen_width, uint screen_height)
+	{
+		sp_profile_function();
+		glm::mat4 projection = camera.getProjectionMatrix();
+		if (projection != _projection)
+			buildClusterBounds(projection);
+
+		glm::mat4 view = camera.getRenderViewMatrix();
+		std::vector<glm::vec4> view_lights(lights.size());
+		for (uint i = 0; i < lights.size(); i++)
+			view_lights[i] = glm::vec4(glm::vec3(view * glm::vec4(lights[i].position, 1.0f)), lights[i].radius);
+
+		//slices own disjoint clusters, no locking needed
+		JobSystem::parallelFor(0, _slices, 1, [this, &view_lights](uint b, uint e) {
+			for (uint s = b; s < e; s++)
+				binSlice(s, view_lights);
+		});
+
+		//compact into offset / count pairs and one index list
+		uint clusters = getClusterCount();
+		_ranges.resize(clusters * 2);
+		_indices.clear();
+		_maxLightsPerCluster = 0;
+		for (uint c = 0; c < clusters; c++)
+		{
+			const std::vector<uint>& list = _clusterLights[c];
+			_ranges[c * 2] = (uint)_indices.size();
+			_ranges[c * 2 + 1] = (uint)list.size();
+			_indices.insert(_indices.end(), list.begin(), list.end());
+			_maxLightsPerCluster = std::max(_maxLightsPerCluster, (uint)list.size());
+		}
+		if (_indices.empty())
+			_indices.push_back(0); // keep the buffer non empty
+
+		//orphaned every frame so the driver never waits on last frame's draws
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, _lightBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, std::max<size_t>(sizeof(PointLight) * lights.size(), sizeof(PointLight)), lights.empty() ? nullptr : &lights[0], GL_STREAM_DRAW);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, _rangeBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(uint) * _ranges.size(), &_ranges[0], GL_STREAM_DRAW);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, _indexBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(uint) * _indices.size(), &_indices[0], GL_STREAM_DRAW);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+		sp_render_stat(upload_bytes, sizeof(PointLight) * lights.size() + sizeof(uint) * (_ranges.size() + _indices.size()));
+
+		Display* display = Application::getMainDisplay();
+		if (screen_width == 0 && display)
+			screen_width = display->getWidth();
+		if (screen_height == 0 && display)
+			screen_height = display->getHeight();
+		ClusterParams params = {
+			{ _tilesX, _tilesY, _slices, (uint)lights.size() },
+			{ _near, _far, _slices / std::log(_far / _near), 0.0f },
+			{ float(screen_width), float(screen_height), 0.0f, 0.0f } };
+		_params->setData(&params, sizeof(ClusterParams));
+		bind();
+	}
+
+	void LightClusterGrid::bind()
+	{
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, cnst_cluster_light_ssbo_binding, _lightBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, cnst_cluster_range_ssbo_binding, _rangeBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, cnst_cluster_index_ssbo_binding, _indexBuffer);
+		_params->bind();
+	}
+
+	uint LightClusterGrid::getClusterLightCount(uint x, uint y, uint slice) const
+	{
+		uint c = (slice * _tilesY + y) * _tilesX + x;
+		return c * 2 + 1 < _ranges.size() ? _ranges[c * 2 + 1] : 0;
+	}
+
+};
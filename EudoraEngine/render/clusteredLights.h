@@ -0,0 +1,103 @@
+#pragma once
+#include "../api.h"
+#include "light.h"
+#include "uniformBuffer.h"
+#include "../control/camera.h"
+#include <vector>
+
+namespace sp {
+
+	//buffer bindings used by cnst_glsl_cluster_lighting
+	const uint cnst_cluster_ubo_binding = 1; // next to the camera block
+	const uint cnst_cluster_light_ssbo_binding = 0;
+	const uint cnst_cluster_range_ssbo_binding = 1;
+	const uint cnst_cluster_index_ssbo_binding = 2;
+
+	//paste after cnst_glsl_camera_block into forward shaders
+	//sp_clustered_lighting() shades a surface point with only the lights binned into its cluster
+	const char* const cnst_glsl_cluster_lighting =
+		"layout(std140, binding = 1) uniform sp_clusters\n"
+		"{\n"
+		"	uvec4 cluster_grid; // tiles x, tiles y, slices, light count\n"
+		"	vec4 cluster_depth; // near, far, slices / log(far / near)\n"
+		"	vec4 cluster_screen; // width, height\n"
+		"};\n"
+		"struct sp_point_light { vec4 position_radius; vec4 color_intensity; };\n"
+		"layout(std430, binding = 0) readonly buffer sp_light_data { sp_point_light sp_lights[]; };\n"
+		"layout(std430, binding = 1) readonly buffer sp_cluster_data { uvec2 sp_cluster_ranges[]; };\n"
+		"layout(std430, binding = 2) readonly buffer sp_light_index_data { uint sp_light_indices[]; };\n"
+		"uint sp_cluster_index(vec2 frag_coord, float view_depth)\n"
+		"{\n"
+		"	uvec2 tile = uvec2(clamp(frag_coord / cluster_screen.xy, 0.0, 0.9999) * vec2(cluster_grid.xy));\n"
+		"	uint slice = uint(clamp(log(max(view_depth, cluster_depth.x) / cluster_depth.x) * cluster_depth.z, 0.0, float(cluster_grid.z - 1u)));\n"
+		"	return (slice * cluster_grid.y + tile.y) * cluster_grid.x + tile.x;\n"
+		"}\n"
+		"vec3 sp_clustered_lighting(vec3 world_position, vec3 normal, vec3 albedo, float specular)\n"
+		"{\n"
+		"	float view_depth = -(camera_view * vec4(world_position, 1.0)).z;\n"
+		"	uvec2 range = sp_cluster_ranges[sp_cluster_index(gl_FragCoord.xy, view_depth)];\n"
+		"	vec3 v = normalize(camera_position.xyz - world_position);\n"
+		"	vec3 result = vec3(0.0);\n"
+		"	for (uint i = range.x; i < range.x + range.y; i++)\n"
+		"	{\n"
+		"		sp_point_light light = sp_lights[sp_light_indices[i]];\n"
+		"		vec3 to_light = light.position_radius.xyz - world_position;\n"
+		"		float d = length(to_light);\n"
+		"		float window = clamp(1.0 - pow(d / light.position_radius.w, 4.0), 0.0, 1.0);\n"
+		"		float attenuation = window * window / (d * d + 1.0);\n"
+		"		vec3 l = to_light / max(d, 0.0001);\n"
+		"		float diffuse = max(dot(normal, l), 0.0);\n"
+		"		float spec = diffuse > 0.0 ? pow(max(dot(normal, normalize(l + v)), 0.0), 32.0) * specular : 0.0;\n"
+		"		result += (albedo * diffuse + spec) * light.color_intensity.rgb * light.color_intensity.a * attenuation;\n"
+		"	}\n"
+		"	return result;\n"
+		"}\n";
+
+	//clustered forward lighting
+	//the camera frustum is split into tiles x tiles y x slices clusters (slices are exponential in depth),
+	//every frame the lights are binned into the clusters their sphere touches on the job system,
+	//and the compact per cluster index lists are uploaded to shader storage buffers
+	//perspective cameras only
+	class SP_API LightClusterGrid
+	{
+	private:
+		uint _tilesX;
+		uint _tilesY;
+		uint _slices;
+		uint _rowStride; // tiles x * tiles y padded to a multiple of 4 for the simd test
+		float _near = 0.0f;
+		float _far = 0.0f;
+		glm::mat4 _projection = glm::mat4(0.0f); // the cluster bounds were built for this
+
+		//view space cluster bounds, structure of arrays, _slices rows of _rowStride
+		std::vector<float> _minX, _minY, _minZ, _maxX, _maxY, _maxZ;
+		std::vector<std::vector<uint>> _clusterLights; // reused every frame, only grows
+		std::vector<uint> _ranges; // offset, count per cluster
+		std::vector<uint> _indices;
+		uint _maxLightsPerCluster = 0;
+
+		uint _lightBuffer = 0;
+		uint _rangeBuffer = 0;
+		uint _indexBuffer = 0;
+		UniformBuffer* _params;
+	public:
+		LightClusterGrid(uint tiles_x = 16, uint tiles_y = 9, uint slices = 24);
+		~LightClusterGrid();
+		LightClusterGrid(const LightClusterGrid&) = delete;
+		LightClusterGrid& operator=(const LightClusterGrid&) = delete;
+
+		//bins and uploads, screen size 0 uses the display, leaves the buffers bound
+		void update(Camera& camera, const std::vector<PointLight>& lights, uint screen_width = 0, uint screen_height = 0);
+		void bind(); // binds the buffers to the cnst_cluster_* bindings
+
+		uint getClusterCount() const { return _tilesX * _tilesY * _slices; }
+		uint getLightIndexCount() const { return (uint)_indices.size(); }
+		uint getMaxLightsPerCluster() const { return _maxLightsPerCluster; }
+		uint getClusterLightCount(uint x, uint y, uint slice) const;
+
+	private:
+		void buildClusterBounds(const glm::mat4& projection);
+		void binSlice(uint slice, const std::vector<glm::vec4>& view_lights);
+	};
+
+};
@@ -0,0 +1,383 @@
+#include "deferredRenderer.h"
+#include "../console.h"
+#include "../control/logger.h"
+#include "../control/profiler.h"
+#include "../deps/glad.h"
+#include <cmath>
+
+namespace sp {
+
+	const uint cnst_light_sphere_slices = 16;
+	const uint cnst_light_sphere_stacks = 10;
+
+	const char* const xGBufferVertexShaderSource = R"(
+	layout (location = 0) in vec3 position;
+	layout (location = 1) in vec3 normal;
+	layout (location = 2) in vec2 uv;
+
+	uniform mat4 model_matrix;
+	uniform mat4 normal_matrix;
+
+	out vec3 world_normal;
+	out vec2 tex_cord;
+
+	void main()
+	{
+		world_normal = mat3(normal_matrix) * normal;
+		tex_cord = uv;
+		gl_Position = camera_view_projection * model_matrix * vec4(position, 1.0);
+	}
+	)";
+
+	const char* const xGBufferFragmentShaderSource = R"(
+	in vec3 world_normal;
+	in vec2 tex_cord;
+
+	layout (location = 0) out vec4 gbuffer_albedo;
+	layout (location = 1) out vec2 gbuffer_normal;
+
+	uniform sampler2D tex_diffuse0;
+	uniform sampler2D tex_specular0;
+
+	vec2 octEncode(vec3 n)
+	{
+		n /= abs(n.x) + abs(n.y) + abs(n.z);
+		vec2 s = vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+		return n.z >= 0.0 ? n.xy : (1.0 - abs(n.yx)) * s;
+	}
+
+	void main()
+	{
+		vec4 albedo = texture(tex_diffuse0, tex_cord);
+		if (albedo.a < 0.5)
+			discard;
+		gbuffer_albedo = vec4(albedo.rgb, texture(tex_specular0, tex_cord).r);
+		gbuffer_normal = octEncode(normalize(world_normal));
+	}
+	)";
+
+	//shared by both lighting shaders
+	const char* const xGBufferDecodeSource = R"(
+	uniform sampler2D gbuffer_albedo_texture;
+	uniform sampler2D gbuffer_normal_texture;
+	uniform sampler2D gbuffer_depth_texture;
+	uniform mat4 inverse_view_projection;
+	uniform vec4 gbuffer_uv_scale; // xy, rendered part of the gbuffer textures (dynamic resolution)
+
+	//uv over the lighting viewport -> uv into the gbuffer textures
+	vec2 gbufferUv(vec2 screen_uv)
+	{
+		return screen_uv * gbuffer_uv_scale.xy;
+	}
+
+	vec3 octDecode(vec2 e)
+	{
+		vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+		if (n.z < 0.0)
+			n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+		return normalize(n);
+	}
+
+	vec3 worldPosition(vec2 uv, float depth)
+	{
+		vec4 p = inverse_view_projection * vec4(uv * 2.0 - 1.0, depth * 2.0 - 1.0, 1.0);
+		return p.xyz / p.w;
+	}
+	)";
+
+	const char* const xAmbientVertexShaderSource = R"(
+	layout (location = 0) in vec3 position;
+	out vec2 tex_cord;
+
+	void main()
+	{
+		tex_cord = position.xy * 0.5 + 0.5;
+		gl_Position = vec4(position.xy, 0.0, 1.0);
+	}
+	)";
+
+	const char* const xAmbientFragmentShaderSource = R"(
+	in vec2 tex_cord;
+	out vec4 frag_color;
+
+	uniform vec3 ambient_color;
+	uniform vec3 sun_direction;
+	uniform vec3 sun_color;
+
+	void main()
+	{
+		vec2 uv = gbufferUv(tex_cord);
+		float depth = texture(gbuffer_depth_texture, uv).r;
+		if (depth >= 1.0)
+			discard;
+		vec4 albedo = texture(gbuffer_albedo_texture, uv);
+		vec3 n = octDecode(texture(gbuffer_normal_texture, uv).rg);
+		vec3 l = -normalize(sun_direction);
+		vec3 v = normalize(camera_position.xyz - worldPosition(tex_cord, depth));
+		float diffuse = max(dot(n, l), 0.0);
+		float specular = diffuse > 0.0 ? pow(max(dot(n, normalize(l + v)), 0.0), 32.0) * albedo.a : 0.0;
+		frag_color = vec4(albedo.rgb * ambient_color + (albedo.rgb * diffuse + specular) * sun_color, 1.0);
+	}
+	)";
+
+	const char* const xLightVertexShaderSource = R"(
+	layout (location = 0) in vec3 position;
+	layout (location = 1) in mat4 light_data; // column 0 position radius, column 1 color intensity
+
+	flat out vec4 light_position_radius;
+	flat out vec4 light_color_intensity;
+
+	void main()
+	{
+		light_position_radius = light_data[0];
+		light_color_intensity = light_data[1];
+		//the tessellated sphere sits inside the true one, grow it so it still covers the whole radius
+		vec3 world = light_data[0].xyz + position * light_data[0].w * 1.05;
+		gl_Position = camera_view_projection * vec4(world, 1.0);
+	}
+	)";
+
+	const char* const xLightFragmentShaderSource = R"(
+	flat in vec4 light_position_radius;
+	flat in vec4 light_color_intensity;
+	out vec4 frag_color;
+
+	uniform vec4 screen_viewport; // x, y, width, height of the lighting viewport
+
+	void main()
+	{
+		vec2 screen_uv = (gl_FragCoord.xy - screen_viewport.xy) / screen_viewport.zw;
+		vec2 uv = gbufferUv(screen_uv);
+		float depth = texture(gbuffer_depth_texture, uv).r;
+		if (depth >= 1.0)
+			discard;
+		vec3 p = worldPosition(screen_uv, depth);
+		vec3 to_light = light_position_radius.xyz - p;
+		float d = length(to_light);
+		float r = light_position_radius.w;
+		if (d >= r)
+			discard;
+		float window = clamp(1.0 - pow(d / r, 4.0), 0.0, 1.0);
+		float attenuation = window * window / (d * d + 1.0);
+
+		vec4 albedo = texture(gbuffer_albedo_texture, uv);
+		vec3 n = octDecode(texture(gbuffer_normal_texture, uv).rg);
+		vec3 l = to_light / d;
+		vec3 v = normalize(camera_position.xyz - p);
+		float diffuse = max(dot(n, l), 0.0);
+		float specular = diffuse > 0.0 ? pow(max(dot(n, normalize(l + v)), 0.0), 32.0) * albedo.a : 0.0;
+		frag_color = vec4((albedo.rgb * diffuse + specular) * light_color_intensity.rgb * light_color_intensity.a * attenuation, 1.0);
+	}
+	)";
+
+	static ShaderProgram* compileDeferredShader(const char* vertex, const char* fragment, bool decode)
+	{
+		std::string header = std::string("#version 440 core\n") + cnst_glsl_camera_block;
+		std::string fragment_source = header + (decode ? xGBufferDecodeSource : "") + fragment;
+		return new ShaderProgram({ std::make_pair(header + vertex, ShaderSourceType::vertex), std::make_pair(fragment_source, ShaderSourceType::fragment) });
+	}
+
+	static Texture* genSolidTexture(byte r, byte g, byte b, byte a)
+	{
+		byte pixel[4] = { r, g, b, a };
+		Texture* t = new Texture(1, 1, TextureFormat::rgba8);
+		t->bind();
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixel);
+		return t;
+	}
+
+	//unit uv sphere, counter clockwise seen from outside
+	static VertexArray* genLightSphere()
+	{
+		const float pi = 3.14159265f;
+		std::vector<glm::vec3> vertices = {};
+		std::vector<uint> indices = {};
+		for (uint st = 0; st <= cnst_light_sphere_stacks; st++)
+		{
+			float phi = pi * st / cnst_light_sphere_stacks;
+			for (uint sl = 0; sl <= cnst_light_sphere_slices; sl++)
+			{
+				float theta = 2.0f * pi * sl / cnst_light_sphere_slices;
+				vertices.push_back(glm::vec3(std::sin(phi) * std::cos(theta), std::cos(phi), std::sin(phi) * std::sin(theta)));
+			}
+		}
+		uint row = cnst_light_sphere_slices + 1;
+		for (uint st = 0; st < cnst_light_sphere_stacks; st++)
+		{
+			for (uint sl = 0; sl < cnst_light_sphere_slices; sl++)
+			{
+				uint a = st * row + sl;
+				uint b = a + row;
+				indices.insert(indices.end(), { a, a + 1, b, b, a + 1, b + 1 });
+			}
+		}
+		return VertexArray::genVertexArray(&vertices[0], (uint)(sizeof(glm::vec3) * vertices.size()), indices,
+			{ { 0, sizeof(glm::vec3), 3, 'f' } });
+	}
+
+	static FrameBufferLayout gbufferLayout()
+	{
+		FrameBufferLayout layout;
+		layout.colors = { TextureFormat::rgba8, TextureFormat::rg16f };
+		layout.depth = TextureFormat::depth32f;
+		layout.sampleable_depth = true;
+		return layout;
+	}
+
+	static FrameBufferLayout lightingLayout()
+	{
+		FrameBufferLayout layout;
+		layout.colors = { TextureFormat::rgba16f };
+		return layout;
+	}
+
+
+	GBufferPass::GBufferPass(uint width, uint height, uint resolution)
+		: RenderInterface("gbuffer", width, height, gbufferLayout(), resolution)
+	{
+		_shader = compileDeferredShader(xGBufferVertexShaderSource, xGBufferFragmentShaderSource, false);
+		_white = genSolidTexture(255, 255, 255, 255);
+		_black = genSolidTexture(0, 0, 0, 255);
+	}
+
+	GBufferPass::~GBufferPass()
+	{
+		delete _shader;
+		delete _white;
+		delete _black;
+	}
+
+	void GBufferPass::submit(RenderModel* model, glm::mat4 world_transform)
+	{
+		_queue.push_back({ model, world_transform });
+	}
+
+	void GBufferPass::onRender()
+	{
+		sp_profile_function();
+		if (_camera)
+			RenderCommand::submitCamera(*_camera);
+		glEnable(GL_DEPTH_TEST);
+		glDepthMask(GL_TRUE);
+		glDisable(GL_BLEND);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+		_shader->bind();
+		for (DrawItem& item : _queue)
+		{
+			RenderModel* model = item.model;
+			for (RenderModelEntity& e : model->entities)
+			{
+				glm::mat4 model_matrix = item.world_transform * model->localTransforms[e.trans].getModelMatrix();
+				_shader->uniform_m4(model_matrix, cnst_txt_matrix_model);
+				_shader->uniform_m4(glm::mat4(glm::transpose(glm::inverse(glm::mat3(model_matrix)))), "normal_matrix");
+				for (RenderModelInfo& m : e._modelMaps)
+				{
+					Texture* diffuse = _white;
+					Texture* specular = _black;
+					for (uint i = 0; i < m.textures.size(); i++)
+					{
+						if (m.texture_names[i] == "tex_diffuse0")
+							diffuse = model->textures[m.textures[i]];
+						else if (m.texture_names[i] == "tex_specular0")
+							specular = model->textures[m.textures[i]];
+					}
+					diffuse->bind(_shader, 0, "tex_diffuse0");
+					specular->bind(_shader, 1, "tex_specular0");
+					model->vaos[m.vao]->draw();
+				}
+			}
+		}
+		_queue.clear();
+	}
+
+
+	DeferredLightingPass::DeferredLightingPass(GBufferPass* gbuffer, uint width, uint height, uint resolution)
+		: RenderInterface("deferred_lighting", width, height, lightingLayout(), resolution),
+		_gbuffer(gbuffer)
+	{
+		_ambientShader = compileDeferredShader(xAmbientVertexShaderSource, xAmbientFragmentShaderSource, true);
+		_lightShader = compileDeferredShader(xLightVertexShaderSource, xLightFragmentShaderSource, true);
+		_quad = VertexArray::genQuad(2.0f, 2.0f);
+		_sphere = genLightSphere();
+	}
+
+	DeferredLightingPass::~DeferredLightingPass()
+	{
+		delete _ambientShader;
+		delete _lightShader;
+		delete _quad;
+		delete _sphere;
+	}
+
+	void DeferredLightingPass::onRender()
+	{
+		sp_profile_function();
+		Camera* camera = _gbuffer->getCamera();
+		if (camera == nullptr)
+		{
+			static bool s_warned = false;
+			if (!s_warned)
+				Logger::warn(LogCategory::render, "deferred lighting needs the gbuffer pass camera, pass skipped");
+			s_warned = true;
+			return;
+		}
+		glm::mat4 inverse_view_projection = glm::inverse(camera->getProjectionMatrix() * camera->getRenderViewMatrix());
+		GLint viewport[4];
+		glGetIntegerv(GL_VIEWPORT, viewport);
+		//the gbuffer may be drawn into only part of its textures, by dynamic resolution or a different resolution
+		FrameBuffer* gbuffer = _gbuffer->getFrameBuffer();
+		glm::vec4 uv_scale = glm::vec4(float(gbuffer->getRenderWidth()) / gbuffer->getWidth(), float(gbuffer->getRenderHeight()) / gbuffer->getHeight(), 0.0f, 0.0f);
+
+		glClear(GL_COLOR_BUFFER_BIT);
+		glDisable(GL_DEPTH_TEST);
+		glDepthMask(GL_FALSE);
+
+		//ambient and directional, every covered pixel once
+		_ambientShader->bind();
+		_gbuffer->getAlbedoTexture()->bind(_ambientShader, 0, "gbuffer_albedo_texture");
+		_gbuffer->getNormalTexture()->bind(_ambientShader, 1, "gbuffer_normal_texture");
+		_gbuffer->getDepthTexture()->bind(_ambientShader, 2, "gbuffer_depth_texture");
+		_ambientShader->uniform_m4(inverse_view_projection, "inverse_view_projection");
+		_ambientShader->uniform_v4(uv_scale, "gbuffer_uv_scale");
+		_ambientShader->uniform_v3(_ambient, "ambient_color");
+		_ambientShader->uniform_v3(_sunDirection, "sun_direction");
+		_ambientShader->uniform_v3(_sunColor, "sun_color");
+		_quad->draw();
+
+		//point lights, back faces so the volume still rasterizes with the camera inside it
+		if (!_lights.empty())
+		{
+			std::vector<glm::mat4> instances(_lights.size());
+			for (uint i = 0; i < _lights.size(); i++)
+			{
+				instances[i][0] = glm::vec4(_lights[i].position, _lights[i].radius);
+				instances[i][1] = glm::vec4(_lights[i].color, _lights[i].intensity);
+			}
+			if (!_sphere->IsInstanced())
+				_sphere->makeInstance(&instances[0], (uint)(sizeof(glm::mat4) * instances.size()), { { 0, sizeof(glm::mat4), 4, 'm' } }, (int)instances.size());
+			else
+				_sphere->setInstanceData(&instances[0], (uint)(sizeof(glm::mat4) * instances.size()), (int)instances.size());
+
+			glEnable(GL_BLEND);
+			glBlendFunc(GL_ONE, GL_ONE);
+			glEnable(GL_CULL_FACE);
+			glCullFace(GL_FRONT);
+			_lightShader->bind();
+			_gbuffer->getAlbedoTexture()->bind(_lightShader, 0, "gbuffer_albedo_texture");
+			_gbuffer->getNormalTexture()->bind(_lightShader, 1, "gbuffer_normal_texture");
+			_gbuffer->getDepthTexture()->bind(_lightShader, 2, "gbuffer_depth_texture");
+			_lightShader->uniform_m4(inverse_view_projection, "inverse_view_projection");
+			_lightShader->uniform_v4(uv_scale, "gbuffer_uv_scale");
+			_lightShader->uniform_v4(glm::vec4(float(viewport[0]), float(viewport[1]), float(viewport[2]), float(viewport[3])), "screen_viewport");
+			_sphere->draw();
+			glCullFace(GL_BACK);
+			glDisable(GL_CULL_FACE);
+			glDisable(GL_BLEND);
+		}
+
+		glDepthMask(GL_TRUE);
+		glEnable(GL_DEPTH_TEST);
+	}
+
+};
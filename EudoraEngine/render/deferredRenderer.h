@@ -0,0 +1,78 @@
+#pragma once
+#include "../api.h"
+#include "renderer.h"
+#include "renderModel.h"
+#include "light.h"
+#include "../control/camera.h"
+#include <vector>
+
+namespace sp {
+
+	//gbuffer attachment indices
+	const uint cnst_gbuffer_albedo = 0; // rgba8, rgb albedo, a specular strength
+	const uint cnst_gbuffer_normal = 1; // rg16f, octahedral encoded world normal
+	//world position is reconstructed from the sampleable depth, no position target is stored
+
+	//geometry pass of the deferred pipeline
+	//submit models every frame, onRender draws them into the gbuffer and clears the queue
+	//meshes use their tex_diffuse0 / tex_specular0 textures, missing ones fall back to white / black
+	class SP_API GBufferPass : public RenderInterface
+	{
+	private:
+		struct DrawItem
+		{
+			RenderModel* model;
+			glm::mat4 world_transform;
+		};
+
+		ShaderProgram* _shader;
+		Texture* _white;
+		Texture* _black;
+		Camera* _camera = nullptr;
+		std::vector<DrawItem> _queue;
+	public:
+		GBufferPass(uint width, uint height, uint resolution = 1);
+		~GBufferPass();
+
+		void setCamera(Camera* camera) { _camera = camera; } // submitted to the camera block at the start of the pass
+		Camera* getCamera() const { return _camera; }
+		void submit(RenderModel* model, glm::mat4 world_transform = glm::mat4(1.0f));
+
+		Texture* getAlbedoTexture() const { return getFrameBuffer()->getTexture(cnst_gbuffer_albedo); }
+		Texture* getNormalTexture() const { return getFrameBuffer()->getTexture(cnst_gbuffer_normal); }
+		Texture* getDepthTexture() const { return getFrameBuffer()->getDepthTexture(); }
+
+		void onRender() override;
+		void onDestroy() override {}
+	};
+
+	//lighting pass of the deferred pipeline
+	//a full screen pass applies ambient and the directional light, then every point light is drawn as an
+	//instanced sphere with additive blending, so a light only shades the pixels its volume covers
+	//writes hdr (rgba16f) offscreen, or straight to the screen when rendered last
+	class SP_API DeferredLightingPass : public RenderInterface
+	{
+	private:
+		GBufferPass* _gbuffer;
+		ShaderProgram* _ambientShader;
+		ShaderProgram* _lightShader;
+		VertexArray* _quad;
+		VertexArray* _sphere;
+		std::vector<PointLight> _lights;
+		glm::vec3 _ambient = glm::vec3(0.05f);
+		glm::vec3 _sunDirection = glm::vec3(-0.3f, -1.0f, -0.2f);
+		glm::vec3 _sunColor = glm::vec3(0.0f);
+	public:
+		DeferredLightingPass(GBufferPass* gbuffer, uint width, uint height, uint resolution = 1);
+		~DeferredLightingPass();
+
+		void setLights(const std::vector<PointLight>& lights) { _lights = lights; }
+		std::vector<PointLight>& getLights() { return _lights; }
+		void setAmbient(glm::vec3 color) { _ambient = color; }
+		void setDirectionalLight(glm::vec3 direction, glm::vec3 color) { _sunDirection = direction; _sunColor = color; }
+
+		void onRender() override;
+		void onDestroy() override {}
+	};
+
+};
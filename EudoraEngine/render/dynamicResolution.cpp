@@ -0,0 +1,62 @@
+#include "dynamicResolution.h"
+#include "renderer.h"
+#include <algorithm>
+#include <cmath>
+
+namespace sp {
+
+	const float cnst_dynres_smoothing = 0.15f; // weight of the newest sample
+	const float cnst_dynres_deadband = 0.03f; // relative scale change ignored as noise
+	const float cnst_dynres_max_step = 0.1f; // largest relative change per adjustment
+
+	DynamicResolution::DynamicResolution(float target_ms, float min_scale, float max_scale)
+		:_target_ms(target_ms),
+		_min_scale(0.5f),
+		_max_scale(1.0f),
+		_scale(1.0f),
+		_filtered_ms(0.0f),
+		_cooldown(0)
+	{
+		setBounds(min_scale, max_scale);
+		_scale = _max_scale;
+	}
+
+	void DynamicResolution::setBounds(float min_scale, float max_scale)
+	{
+		_max_scale = std::min(std::max(max_scale, 0.01f), 1.0f);
+		_min_scale = std::min(std::max(min_scale, 0.01f), _max_scale);
+		_scale = std::min(std::max(_scale, _min_scale), _max_scale);
+	}
+
+	void DynamicResolution::reset()
+	{
+		_scale = _max_scale;
+		_filtered_ms = 0.0f;
+		_cooldown = 0;
+	}
+
+	float DynamicResolution::update(float gpu_ms)
+	{
+		if (gpu_ms <= 0.0f || _target_ms <= 0.0f)
+			return _scale;
+		_filtered_ms = _filtered_ms <= 0.0f ? gpu_ms : _filtered_ms + (gpu_ms - _filtered_ms) * cnst_dynres_smoothing;
+		if (_cooldown > 0)
+		{
+			_cooldown--;
+			return _scale;
+		}
+
+		float ratio = std::sqrt(_target_ms / _filtered_ms);
+		ratio = std::min(std::max(ratio, 1.0f - cnst_dynres_max_step), 1.0f + cnst_dynres_max_step);
+		float scale = std::min(std::max(_scale * ratio, _min_scale), _max_scale);
+		if (std::fabs(scale - _scale) < _scale * cnst_dynres_deadband)
+			return _scale;
+
+		//the filtered time still holds the old scale, assume the change lands and wait for the timer to catch up
+		_filtered_ms *= (scale * scale) / (_scale * _scale);
+		_scale = scale;
+		_cooldown = cnst_gpu_timer_latency + 1;
+		return _scale;
+	}
+
+};
@@ -0,0 +1,31 @@
+#pragma once
+#include "../api.h"
+
+namespace sp {
+
+	//picks a render scale that keeps the measured gpu frame time near a target
+	//gpu cost is treated as proportional to pixel count, so the scale moves with sqrt(target / measured)
+	//measurements are smoothed and only acted on after the gpu timer latency has passed, which keeps it from oscillating
+	class SP_API DynamicResolution
+	{
+	private:
+		float _target_ms;
+		float _min_scale;
+		float _max_scale;
+		float _scale;
+		float _filtered_ms;
+		uint _cooldown; // frames until the last change shows up in the timings
+	public:
+		DynamicResolution(float target_ms = 16.0f, float min_scale = 0.5f, float max_scale = 1.0f);
+
+		float update(float gpu_ms); // call once per frame, returns the scale to render with
+		void reset(); // back to max scale, e.g. after a scene change
+
+		float getScale() const { return _scale; }
+		float getTarget_ms() const { return _target_ms; }
+		float getFilteredGpuTime_ms() const { return _filtered_ms; }
+		void setTarget_ms(float ms) { _target_ms = ms; }
+		void setBounds(float min_scale, float max_scale); // fractions of the preallocated target, (0, 1]
+	};
+
+};
@@ -0,0 +1,171 @@
+#include "glDebug.h"
+#include "../console.h"
+#include "../control/logger.h"
+#include "../deps/glad.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace sp {
+
+	struct GLDebugEntry
+	{
+		uint source;
+		uint type;
+		uint id;
+		uint severity;
+		uint64_t count;
+		uint first_frame;
+		uint last_frame;
+		uint printed_frame; // last frame it went to the console
+		uint64_t printed_count; // count at that time
+		std::string message; // first one seen
+	};
+
+	bool GLDebug::_enabled = false;
+	uint GLDebug::_repeatInterval = 600;
+	uint GLDebug::_summaryInterval = 1800;
+
+	static std::mutex s_lock;
+	static std::unordered_map<uint64_t, GLDebugEntry> s_entries;
+	static std::atomic<uint> s_frame{ 0 };
+	static bool s_countsChanged = false; // a message arrived since the last summary
+
+	//opengl debug callback
+	static void GLAPIENTRY error_callback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar* message, const void* useParam)
+	{
+		GLDebug::onMessage(source, type, id, severity, message);
+	}
+
+	static const char* sourceName(uint source)
+	{
+		switch (source)
+		{
+		case GL_DEBUG_SOURCE_API: return "api";
+		case GL_DEBUG_SOURCE_WINDOW_SYSTEM: return "window";
+		case GL_DEBUG_SOURCE_SHADER_COMPILER: return "shader";
+		case GL_DEBUG_SOURCE_THIRD_PARTY: return "third party";
+		case GL_DEBUG_SOURCE_APPLICATION: return "application";
+		default: return "other";
+		}
+	}
+
+	static const char* typeName(uint type)
+	{
+		switch (type)
+		{
+		case GL_DEBUG_TYPE_ERROR: return "error";
+		case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR: return "deprecated";
+		case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR: return "undefined";
+		case GL_DEBUG_TYPE_PORTABILITY: return "portability";
+		case GL_DEBUG_TYPE_PERFORMANCE: return "performance";
+		case GL_DEBUG_TYPE_MARKER: return "marker";
+		default: return "other";
+		}
+	}
+
+	void GLDebug::setEnabled(bool enable)
+	{
+		_enabled = enable;
+		if (enable)
+		{
+			glEnable(GL_DEBUG_OUTPUT);
+			glDebugMessageCallback(error_callback, 0);
+			//notifications are never printed, keep the driver from generating them
+			glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DEBUG_SEVERITY_NOTIFICATION, 0, nullptr, GL_FALSE);
+		}
+		else
+		{
+			glDebugMessageCallback(nullptr, 0);
+			glDisable(GL_DEBUG_OUTPUT);
+		}
+	}
+
+	void GLDebug::onMessage(uint source, uint type, uint id, uint severity, const char* message)
+	{
+		uint frame = s_frame.load(std::memory_order_relaxed);
+		uint64_t key = (uint64_t(source & 0xFFFF) << 48) | (uint64_t(type & 0xFFFF) << 32) | id;
+		bool print = false;
+		uint64_t repeats = 0;
+		uint since = 0;
+		{
+			std::lock_guard<std::mutex> guard(s_lock);
+			s_countsChanged = true;
+			auto it = s_entries.find(key);
+			if (it == s_entries.end())
+			{
+				s_entries[key] = { source, type, id, severity, 1, frame, frame, frame, 1, message };
+				print = true;
+			}
+			else
+			{
+				GLDebugEntry& e = it->second;
+				e.count++;
+				e.last_frame = frame;
+				if (_repeatInterval > 0 && frame - e.printed_frame >= _repeatInterval)
+				{
+					print = true;
+					repeats = e.count - e.printed_count;
+					since = e.printed_frame;
+					e.printed_frame = frame;
+					e.printed_count = e.count;
+				}
+			}
+		}
+		if (!print)
+			return;
+		Console::gl_debug(type, message);
+		if (repeats > 0)
+			Logger::info(LogCategory::gl, "( above message repeated {} times since frame {} )", repeats, since);
+	}
+
+	void GLDebug::onFrame()
+	{
+		uint frame = s_frame.fetch_add(1, std::memory_order_relaxed) + 1;
+		if (_summaryInterval == 0 || frame % _summaryInterval != 0)
+			return;
+		{
+			std::lock_guard<std::mutex> guard(s_lock);
+			if (!s_countsChanged)
+				return;
+			s_countsChanged = false;
+		}
+		Logger::logText(LogLevel::info, LogCategory::gl, "", summary());
+	}
+
+	std::string GLDebug::summary()
+	{
+		std::vector<GLDebugEntry> entries;
+		{
+			std::lock_guard<std::mutex> guard(s_lock);
+			for (auto& it : s_entries)
+				entries.push_back(it.second);
+		}
+		std::sort(entries.begin(), entries.end(), [](const GLDebugEntry& a, const GLDebugEntry& b) { return a.count > b.count; });
+
+		std::string table = "opengl debug summary\n";
+		char row[256];
+		std::snprintf(row, sizeof(row), "%-12s %-12s %10s %10s %8s %8s  %s\n", "source", "type", "id", "count", "first", "last", "message");
+		table += row;
+		for (const GLDebugEntry& e : entries)
+		{
+			std::string message = e.message.substr(0, 60);
+			std::replace(message.begin(), message.end(), '\n', ' ');
+			std::snprintf(row, sizeof(row), "%-12s %-12s %10u %10llu %8u %8u  %s\n", sourceName(e.source), typeName(e.type), e.id,
+				(unsigned long long)e.count, e.first_frame, e.last_frame, message.c_str());
+			table += row;
+		}
+		return table;
+	}
+
+	void GLDebug::clear()
+	{
+		std::lock_guard<std::mutex> guard(s_lock);
+		s_entries.clear();
+		s_countsChanged = false;
+	}
+
+};
@@ -0,0 +1,36 @@
+#pragma once
+#include "../api.h"
+#include <string>
+
+namespace sp {
+
+	//debug output is on by default only in debug builds, the callback itself costs driver time
+#ifdef _DEBUG
+	const bool cnst_gl_debug_default = true;
+#else
+	const bool cnst_gl_debug_default = false;
+#endif
+
+	//owns the opengl debug callback
+	//messages are aggregated by (source, type, id) with a count and the first / last frame they were seen,
+	//the first occurrence is printed through Console::gl_debug, repeats at most once per repeat interval,
+	//and a summary table of everything seen is logged at the end of every summary interval in which a message arrived
+	class SP_API GLDebug
+	{
+	private:
+		static bool _enabled;
+		static uint _repeatInterval;
+		static uint _summaryInterval;
+	public:
+		static void setEnabled(bool enable); // needs a current context
+		static bool isEnabled() { return _enabled; }
+		static void setRepeatInterval(uint frames) { _repeatInterval = frames; } // 0 never prints a repeat
+		static void setSummaryInterval(uint frames) { _summaryInterval = frames; } // 0 disables the periodic summary
+
+		static void onMessage(uint source, uint type, uint id, uint severity, const char* message); // may be called from driver threads
+		static void onFrame(); // once per presented frame
+		static std::string summary();
+		static void clear();
+	};
+
+};
@@ -0,0 +1,16 @@
+#pragma once
+#include "../api.h"
+#include "../deps/glm/glm.hpp"
+
+namespace sp {
+
+	//point light as laid out for the gpu, two vec4
+	struct PointLight
+	{
+		glm::vec3 position = glm::vec3(0.0f);
+		float radius = 5.0f; // light is zero at this distance
+		glm::vec3 color = glm::vec3(1.0f);
+		float intensity = 1.0f;
+	};
+
+};
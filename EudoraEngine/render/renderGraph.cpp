@@ -0,0 +1,389 @@
+#include "renderGraph.h"
+#include "../application.h"
+#include "../console.h"
+#include "../control/logger.h"
+#include "../control/profiler.h"
+#include <algorithm>
+#include <functional>
+#include <queue>
+
+namespace sp {
+
+	const uint64_t cnst_render_graph_bytes_per_pixel = 8; // rgba8 color + depth24 stencil8
+
+	RenderGraph::~RenderGraph()
+	{
+		for (PhysicalTarget& p : _physical)
+			delete p.frame_buffer;
+	}
+
+	RenderResource RenderGraph::createTarget(std::string name, uint width, uint height)
+	{
+		_resources.push_back({ name, width, height, nullptr, false, false, -1, -1, -1 });
+		_compiled = false;
+		return (RenderResource)_resources.size() - 1;
+	}
+
+	RenderResource RenderGraph::importTarget(std::string name, FrameBuffer* frame_buffer)
+	{
+		_resources.push_back({ name, 0, 0, frame_buffer, false, false, -1, -1, -1 });
+		_compiled = false;
+		return (RenderResource)_resources.size() - 1;
+	}
+
+	RenderResource RenderGraph::importScreen()
+	{
+		_resources.push_back({ "screen", 0, 0, nullptr, true, true, -1, -1, -1 });
+		_compiled = false;
+		return (RenderResource)_resources.size() - 1;
+	}
+
+	void RenderGraph::markOutput(RenderResource resource)
+	{
+		if (resource >= _resources.size())
+		{
+			Logger::warn(LogCategory::render, "RenderGraph::markOutput: unknown resource {}", resource);
+			return;
+		}
+		_resources[resource].output = true;
+		_compiled = false;
+	}
+
+	void RenderGraph::addPass(std::string name, std::vector<RenderResource> reads, std::vector<RenderResource> writes,
+		std::function<void(RenderGraph&)> execute, bool side_effect)
+	{
+		for (const std::vector<RenderResource>* list : { &reads, &writes })
+		{
+			for (RenderResource r : *list)
+			{
+				if (r < _resources.size())
+					continue;
+				Logger::warn(LogCategory::render, "RenderGraph::addPass: pass {} uses unknown resource {}, pass not added", name, r);
+				return;
+			}
+		}
+		_passes.push_back({ name, reads, writes, execute, side_effect });
+		_compiled = false;
+	}
+
+	void RenderGraph::addPass(RenderInterface* renderer, std::vector<RenderResource> reads, std::vector<RenderResource> writes)
+	{
+		addPass(renderer->getName(), reads, writes, [renderer, reads](RenderGraph& graph) {
+			for (RenderResource r : reads)
+				renderer->pushTexture(cnst_prefix_texture + graph._resources[r].name, graph.getTexture(r));
+			renderer->onRender();
+		});
+	}
+
+	void RenderGraph::compile()
+	{
+		sp_profile_function();
+		uint count = (uint)_passes.size();
+		Display* display = Application::getMainDisplay();
+		_displayWidth = display ? display->getWidth() : 0;
+		_displayHeight = display ? display->getHeight() : 0;
+
+		//dependency edges follow declaration order per resource: writers keep their order, a reader runs after the
+		//last writer declared before it and before the next one, so it sees exactly the writes declared ahead of it
+		std::vector<std::vector<uint>> edges(count);
+		std::vector<uint> indegree(count, 0);
+		auto addEdge = [&](uint from, uint to) {
+			edges[from].push_back(to);
+			indegree[to]++;
+		};
+		for (RenderResource r = 0; r < _resources.size(); r++)
+		{
+			std::vector<uint> writers;
+			for (uint p = 0; p < count; p++)
+				if (std::find(_passes[p].writes.begin(), _passes[p].writes.end(), r) != _passes[p].writes.end())
+					writers.push_back(p);
+			for (uint w = 1; w < writers.size(); w++)
+				addEdge(writers[w - 1], writers[w]);
+			for (uint p = 0; p < count; p++)
+			{
+				const std::vector<RenderResource>& reads = _passes[p].reads;
+				if (std::find(reads.begin(), reads.end(), r) == reads.end())
+					continue;
+				if (std::find(writers.begin(), writers.end(), p) != writers.end())
+					continue; // read-modify-write, ordered with the writers
+				//writers are chained, the nearest one on each side is enough
+				auto next = std::upper_bound(writers.begin(), writers.end(), p);
+				if (next != writers.begin())
+					addEdge(*(next - 1), p);
+				if (next != writers.end())
+					addEdge(p, *next);
+			}
+		}
+
+		//kahn, ties broken by declaration order so the result is stable
+		std::priority_queue<uint, std::vector<uint>, std::greater<uint>> ready;
+		for (uint p = 0; p < count; p++)
+			if (indegree[p] == 0)
+				ready.push(p);
+		std::vector<uint> sorted;
+		while (!ready.empty())
+		{
+			uint p = ready.top();
+			ready.pop();
+			sorted.push_back(p);
+			for (uint next : edges[p])
+				if (--indegree[next] == 0)
+					ready.push(next);
+		}
+		if (sorted.size() != count)
+		{
+			//executes nothing until the graph changes, rather than warning every frame
+			Logger::warn(LogCategory::render, "RenderGraph::compile: dependency cycle, nothing will execute");
+			_order.clear();
+			_compiled = true;
+			return;
+		}
+
+		//cull backwards from the outputs
+		std::vector<bool> needed(_resources.size(), false);
+		for (RenderResource r = 0; r < _resources.size(); r++)
+			needed[r] = _resources[r].output || _resources[r].screen;
+		std::vector<bool> alive(count, false);
+		for (auto it = sorted.rbegin(); it != sorted.rend(); it++)
+		{
+			const Pass& pass = _passes[*it];
+			bool live = pass.side_effect;
+			for (RenderResource w : pass.writes)
+				live = live || needed[w];
+			if (!live)
+				continue;
+			alive[*it] = true;
+			for (RenderResource r : pass.reads)
+				needed[r] = true;
+		}
+		_order.clear();
+		for (uint p : sorted)
+			if (alive[p])
+				_order.push_back(p);
+
+		//lifetimes over the surviving passes
+		for (Resource& r : _resources)
+		{
+			r.first = -1;
+			r.last = -1;
+			r.physical = -1;
+		}
+		for (uint i = 0; i < _order.size(); i++)
+		{
+			const Pass& pass = _passes[_order[i]];
+			for (const std::vector<RenderResource>* list : { &pass.reads, &pass.writes })
+			{
+				for (RenderResource r : *list)
+				{
+					if (_resources[r].first < 0)
+						_resources[r].first = (int)i;
+					_resources[r].last = (int)i;
+				}
+			}
+		}
+
+		for (RenderResource r = 0; r < _resources.size(); r++)
+		{
+			const Resource& res = _resources[r];
+			if (res.first < 0 || res.imported || res.screen)
+				continue;
+			const std::vector<RenderResource>& writes = _passes[_order[res.first]].writes;
+			if (std::find(writes.begin(), writes.end(), r) == writes.end())
+				Logger::warn(LogCategory::render, "RenderGraph::compile: {} is read before any pass writes it, it reads cleared", res.name);
+		}
+
+		//assign transient targets, a framebuffer returns to the free list after the last pass using it
+		//the previous pool is reused where the sizes match, leftovers are released at the end
+		std::vector<bool> used(_physical.size(), false);
+		std::vector<uint> free_list;
+		for (uint p = 0; p < _physical.size(); p++)
+			free_list.push_back(p);
+		for (uint i = 0; i < _order.size(); i++)
+		{
+			for (Resource& r : _resources)
+			{
+				if (r.first != (int)i || r.imported || r.screen)
+					continue;
+				uint width = getTargetWidth(r);
+				uint height = getTargetHeight(r);
+				auto match = std::find_if(free_list.begin(), free_list.end(), [&](uint p) {
+					return _physical[p].width == width && _physical[p].height == height;
+				});
+				if (match != free_list.end())
+				{
+					r.physical = (int)*match;
+					free_list.erase(match);
+				}
+				else
+				{
+					_physical.push_back({ new FrameBuffer(width, height), width, height });
+					used.push_back(false);
+					r.physical = (int)_physical.size() - 1;
+				}
+				used[r.physical] = true;
+			}
+			for (Resource& r : _resources)
+			{
+				if (r.last == (int)i && r.physical >= 0 && !r.output)
+					free_list.push_back((uint)r.physical);
+			}
+		}
+
+		//drop pooled framebuffers this graph no longer needs
+		std::vector<int> remap(_physical.size(), -1);
+		std::vector<PhysicalTarget> kept;
+		for (uint p = 0; p < _physical.size(); p++)
+		{
+			if (used[p])
+			{
+				remap[p] = (int)kept.size();
+				kept.push_back(_physical[p]);
+			}
+			else
+				delete _physical[p].frame_buffer;
+		}
+		_physical.swap(kept);
+		for (Resource& r : _resources)
+			if (r.physical >= 0)
+				r.physical = remap[r.physical];
+
+		_compiled = true;
+	}
+
+	void RenderGraph::execute()
+	{
+		sp_profile_function();
+		//targets of size 0 follow the display, a resize reallocates them
+		Display* display = Application::getMainDisplay();
+		if (display && ((uint)display->getWidth() != _displayWidth || (uint)display->getHeight() != _displayHeight))
+			_compiled = false;
+		if (!_compiled)
+			compile();
+		for (uint i = 0; i < _order.size(); i++)
+		{
+			Pass& pass = _passes[_order[i]];
+			//every transient starts cleared at its first use, whether that pass renders into it or not
+			RenderResource target = pass.writes.empty() ? cnst_render_resource_none : pass.writes[0];
+			for (RenderResource r = 0; r < _resources.size(); r++)
+			{
+				if (r == target || _resources[r].physical < 0 || _resources[r].first != (int)i)
+					continue;
+				bindTarget(r);
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+			}
+			if (target != cnst_render_resource_none)
+			{
+				bindTarget(target);
+				if (_resources[target].physical >= 0 && _resources[target].first == (int)i)
+					glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+			}
+			{
+				sp_profile_scope("RenderGraph::pass");
+				pass.execute(*this);
+			}
+			//multisampled targets resolve once their last writer is done
+			if (!pass.writes.empty() && isLastWriter(i, pass.writes[0]))
+			{
+				FrameBuffer* fb = getFrameBuffer(pass.writes[0]);
+				if (fb && fb->isMultisampled())
+					fb->resolve();
+			}
+		}
+		if (display)
+		{
+			display->bindScreenTarget();
+			glViewport(0, 0, display->getWidth(), display->getHeight());
+		}
+	}
+
+	void RenderGraph::clear()
+	{
+		_passes.clear();
+		_resources.clear();
+		_order.clear();
+		_compiled = false;
+	}
+
+	Texture* RenderGraph::getTexture(RenderResource resource) const
+	{
+		FrameBuffer* fb = getFrameBuffer(resource);
+		return fb ? fb->getTexture() : nullptr;
+	}
+
+	FrameBuffer* RenderGraph::getFrameBuffer(RenderResource resource) const
+	{
+		if (resource >= _resources.size())
+			return nullptr;
+		const Resource& r = _resources[resource];
+		if (r.imported)
+			return r.imported;
+		if (r.physical >= 0)
+			return _physical[r.physical].frame_buffer;
+		return nullptr;
+	}
+
+	std::vector<std::string> RenderGraph::getExecutionOrder() const
+	{
+		std::vector<std::string> names;
+		for (uint p : _order)
+			names.push_back(_passes[p].name);
+		return names;
+	}
+
+	uint64_t RenderGraph::getAllocatedBytes() const
+	{
+		uint64_t bytes = 0;
+		for (const PhysicalTarget& p : _physical)
+			bytes += uint64_t(p.width) * p.height * cnst_render_graph_bytes_per_pixel;
+		return bytes;
+	}
+
+	void RenderGraph::bindTarget(RenderResource resource)
+	{
+		const Resource& r = _resources[resource];
+		if (r.screen)
+		{
+			Display* display = Application::getMainDisplay();
+			if (display)
+			{
+				display->bindScreenTarget();
+				glViewport(0, 0, display->getWidth(), display->getHeight());
+			}
+			return;
+		}
+		FrameBuffer* fb = getFrameBuffer(resource);
+		if (fb)
+		{
+			fb->bind();
+			fb->setViewport(); // graph targets need not match the display
+		}
+	}
+
+	bool RenderGraph::isLastWriter(uint order_index, RenderResource resource) const
+	{
+		for (uint i = order_index + 1; i < _order.size(); i++)
+		{
+			const std::vector<RenderResource>& writes = _passes[_order[i]].writes;
+			if (std::find(writes.begin(), writes.end(), resource) != writes.end())
+				return false;
+		}
+		return true;
+	}
+
+	uint RenderGraph::getTargetWidth(const Resource& r) const
+	{
+		if (r.width > 0)
+			return r.width;
+		Display* display = Application::getMainDisplay();
+		return display ? display->getWidth() : 1;
+	}
+
+	uint RenderGraph::getTargetHeight(const Resource& r) const
+	{
+		if (r.height > 0)
+			return r.height;
+		Display* display = Application::getMainDisplay();
+		return display ? display->getHeight() : 1;
+	}
+
+};
@@ -0,0 +1,96 @@
+#pragma once
+#include "../api.h"
+#include "renderer.h"
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace sp {
+
+	typedef uint RenderResource;
+	const RenderResource cnst_render_resource_none = 0xFFFFFFFF;
+
+	//frame described as passes reading and writing named targets
+	//compile() orders the passes (a read sees the writes declared before it and none declared after it,
+	//declaration order otherwise), culls passes whose results never reach an output, and assigns transient
+	//targets to a pool of framebuffers by lifetime so targets that are never alive at the same time share memory
+	//transient targets hold stale contents, the graph clears them before the first pass that uses them
+	//(a transient read before anything writes it is reported by compile() and reads cleared)
+	//a pass renders into its first write, reads are fetched with getTexture() inside execute
+	//imported multisampled targets are resolved after the last pass that writes them
+	class SP_API RenderGraph
+	{
+	private:
+		struct Resource
+		{
+			std::string name;
+			uint width; // 0 follows the display
+			uint height;
+			FrameBuffer* imported; // not owned
+			bool screen;
+			bool output;
+			int physical; // index into _physical, -1 when not allocated
+			int first; // position in _order of the first / last pass using it
+			int last;
+		};
+		struct Pass
+		{
+			std::string name;
+			std::vector<RenderResource> reads;
+			std::vector<RenderResource> writes;
+			std::function<void(RenderGraph&)> execute;
+			bool side_effect; // never culled
+		};
+		struct PhysicalTarget
+		{
+			FrameBuffer* frame_buffer;
+			uint width;
+			uint height;
+		};
+
+		std::vector<Resource> _resources;
+		std::vector<Pass> _passes;
+		std::vector<uint> _order; // surviving passes in execution order
+		std::vector<PhysicalTarget> _physical;
+		bool _compiled = false;
+		uint _displayWidth = 0; // display size at the last compile, display sized targets follow it
+		uint _displayHeight = 0;
+	public:
+		RenderGraph() {}
+		~RenderGraph();
+		RenderGraph(const RenderGraph&) = delete;
+		RenderGraph& operator=(const RenderGraph&) = delete;
+
+		RenderResource createTarget(std::string name, uint width = 0, uint height = 0); // transient, 0 means display size
+		RenderResource importTarget(std::string name, FrameBuffer* frame_buffer); // lives outside the graph, never aliased
+		RenderResource importScreen(); // the display's screen target, always an output
+		void markOutput(RenderResource resource); // keeps the passes producing it alive
+
+		void addPass(std::string name, std::vector<RenderResource> reads, std::vector<RenderResource> writes,
+			std::function<void(RenderGraph&)> execute, bool side_effect = false);
+		//runs renderer->onRender(), each read is pushed to it as cnst_prefix_texture + resource name
+		void addPass(RenderInterface* renderer, std::vector<RenderResource> reads, std::vector<RenderResource> writes);
+
+		void compile();
+		void execute(); // compiles first if the graph or the display size changed
+		void clear(); // drops passes and resources, keeps the pooled framebuffers for the next compile
+
+		//inside execute: any target; after execute(): outputs and imports only, other transients are recycled and may
+		//already hold another target's contents
+		Texture* getTexture(RenderResource resource) const;
+		FrameBuffer* getFrameBuffer(RenderResource resource) const;
+
+		std::vector<std::string> getExecutionOrder() const;
+		uint getPassCount() const { return (uint)_passes.size(); }
+		uint getCulledPassCount() const { return (uint)(_passes.size() - _order.size()); }
+		uint getPhysicalTargetCount() const { return (uint)_physical.size(); }
+		uint64_t getAllocatedBytes() const; // pooled color + depth storage
+
+	private:
+		void bindTarget(RenderResource resource);
+		bool isLastWriter(uint order_index, RenderResource resource) const;
+		uint getTargetWidth(const Resource& r) const;
+		uint getTargetHeight(const Resource& r) const;
+	};
+
+};
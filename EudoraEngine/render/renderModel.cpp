@@ -3,12 +3,26 @@
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 #include "../console.h"
+#include "../control/logger.h"
+#include "../control/jobSystem.h"
+#include "../control/profiler.h"
 #include "../deps/glad.h"
 
 namespace sp {
 
 	std::unordered_map<std::string, Texture*> RenderModelLoader::_texture_cache = {};
 
+	//material texture slots loaded for every mesh and the uniform prefix they are bound to
+	const std::vector<std::pair<aiTextureType, std::string>> cnst_model_texture_types = {
+		{aiTextureType_DIFFUSE, "tex_diffuse"},
+		{aiTextureType_AMBIENT, "tex_ambient"},
+		{aiTextureType_SPECULAR, "tex_specular"},
+		{aiTextureType_REFLECTION, "tex_reflection"},
+		{aiTextureType_SHININESS, "tex_shininess"},
+		{aiTextureType_NORMALS, "tex_normal"},
+		{aiTextureType_HEIGHT, "tex_height"},
+	};
+
 	glm::mat4 cnvt_mat4(const aiMatrix4x4& AssimpMatrix)
 	{
 		glm::mat4 m(1.0);
@@ -31,6 +45,12 @@ namespace sp {
 		return m;
 	}
 
+	RenderModelData::~RenderModelData()
+	{
+		for (auto& image : images)
+			delete image.second;
+	}
+
 	RenderModelLoader::RenderModelLoader(RenderModel* model)
 		: _model(model)
 	{
@@ -38,6 +58,15 @@ namespace sp {
 
 	void RenderModelLoader::load_file(std::string name, std::string filepath, bool is_animated)
 	{
+		sp_profile_function();
+		RenderModelData* data = decode_file(name, filepath, is_animated);
+		if (data != nullptr)
+			upload_decoded(data);
+	}
+
+	RenderModelData* RenderModelLoader::decode_file(std::string name, std::string filepath, bool is_animated)
+	{
+		sp_profile_function();
 		Assimp::Importer importer;
 		const aiScene* scene = importer.ReadFile(
 			filepath,
@@ -47,17 +76,60 @@ namespace sp {
 			aiProcess_GenNormals);
 		if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
 		{
-			Console::err("assimp scene couldnot been loaded!", importer.GetErrorString());
+			Logger::warn(LogCategory::render, "assimp scene {} could not be loaded: {}", filepath, importer.GetErrorString());
+			return nullptr;
+		}
+		std::string directory = filepath.substr(0, filepath.find_last_of('/'));
+		RenderModelData* data = new RenderModelData();
+		data->name = name;
+		decode_textures(scene, directory, *data);
+		process_node(scene->mRootNode, scene, directory, is_animated, *data, -1);
+		return data;
+	}
+
+	void RenderModelLoader::upload_decoded(RenderModelData* data)
+	{
+		sp_profile_function();
+		for (auto& image : data->images)
+		{
+			if (image.second != nullptr && _texture_cache.find(image.first) == _texture_cache.end())
+				_texture_cache[image.first] = Texture::genTextureFlat(image.second);
 		}
-		_directory = filepath.substr(0, filepath.find_last_of('/'));
+
 		RenderModelEntity entity;
-		entity.name = name;
+		entity.name = data->name;
 		Transform trans;
 		//trans.set_model_matrix(cnvt_mat4(scene->mRootNode->mTransformation)); //producing error
 		entity.trans = _model->localTransforms.size();
 		_model->localTransforms.push_back(trans);
-		process_node(scene->mRootNode, scene, is_animated, entity, -1);
+		for (RenderModelMeshData& mesh : data->meshes)
+		{
+			//add data to model
+			RenderModelInfo model_map;
+
+			VertexArray* vao = VertexArray::genVertexArray(
+				&mesh.vertices[0],
+				sizeof(mesh.vertices[0]) * mesh.vertices.size(),
+				mesh.indices,
+				cnst_vertex_static_layout,
+				GL_STATIC_DRAW);
+			_model->vaos.push_back(vao);
+			model_map.vao = _model->vaos.size() - 1;
+			for (auto& t : mesh.textures)
+			{
+				auto cached = _texture_cache.find(t.first);
+				if (cached == _texture_cache.end())
+					continue; // failed to decode, already reported
+				_model->textures.push_back(cached->second);
+				model_map.textures.push_back(_model->textures.size() - 1);
+				model_map.texture_names.push_back(t.second);
+			}
+
+			model_map.parent_index = mesh.parent_index;
+			entity._modelMaps.push_back(model_map);
+		}
 		_model->entities.push_back(entity);
+		delete data;
 	}
 
 
@@ -73,6 +145,35 @@ namespace sp {
 			return _texture_cache[filepath];
 	}
 
+	void RenderModelLoader::decode_textures(const void* sce, const std::string& directory, RenderModelData& data)
+	{
+		const aiScene* scene = reinterpret_cast<const aiScene*>(sce);
+		//collect every texture file, the render thread skips the ones already in the cache
+		std::vector<std::string> paths = {};
+		for (uint m = 0; m < scene->mNumMaterials; m++)
+		{
+			aiMaterial* material = scene->mMaterials[m];
+			for (auto tt : cnst_model_texture_types)
+			{
+				for (uint i = 0; i < material->GetTextureCount(tt.first); i++)
+				{
+					aiString str;
+					material->GetTexture(tt.first, i, &str);
+					std::string path = directory + '/' + str.C_Str();
+					if (std::find(paths.begin(), paths.end(), path) == paths.end())
+						paths.push_back(path);
+				}
+			}
+		}
+		std::vector<ImageData*> images(paths.size(), nullptr);
+		JobSystem::parallelFor(0, (uint)paths.size(), 1, [&](uint b, uint e) {
+			for (uint i = b; i < e; i++)
+				images[i] = ImageData::genImage(paths[i]);
+		});
+		for (uint i = 0; i < paths.size(); i++)
+			data.images.push_back(std::make_pair(paths[i], images[i]));
+	}
+
 	Texture* RenderModelLoader::genTextureCubemap(std::vector<std::string> filepaths)
 	{
 		std::vector<const char*> fps = {};
@@ -81,7 +182,7 @@ namespace sp {
 		return Texture::genTextureCubemap(fps);
 	}
 
-	void RenderModelLoader::process_node(void* nod, const void* sce, bool is_animated, RenderModelEntity& entity, int index)
+	void RenderModelLoader::process_node(void* nod, const void* sce, const std::string& directory, bool is_animated, RenderModelData& data, int index)
 	{
 		aiNode* node = reinterpret_cast<aiNode*>(nod);
 		aiScene* scene = reinterpret_cast<aiScene*>((void*)sce);
@@ -93,9 +194,8 @@ namespace sp {
 			//do mesh loading
 			if (!is_animated)
 			{
-				std::vector<Vertex_static> vertices = {};
-				std::vector<uint> indices = {};
-				std::vector<std::pair<Texture*, std::string>> textures = {};
+				RenderModelMeshData mesh_data;
+				mesh_data.vertices.reserve(mesh->mNumVertices);
 				for (uint i = 0; i < mesh->mNumVertices; i++)
 				{
 					Vertex_static vertex;
@@ -121,7 +221,7 @@ namespace sp {
 					else
 						vertex.uv = glm::vec2(0.0f, 0.0f);
 
-					vertices.push_back(vertex);
+					mesh_data.vertices.push_back(vertex);
 				}
 
 				// process indices
@@ -129,58 +229,27 @@ namespace sp {
 				{
 					aiFace face = mesh->mFaces[i];
 					for (unsigned int j = 0; j < face.mNumIndices; j++)
-						indices.push_back(face.mIndices[j]);
+						mesh_data.indices.push_back(face.mIndices[j]);
 				}
 				// process material
 				if (mesh->mMaterialIndex >= 0)
 				{
 					aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
 
-					std::vector<std::pair<aiTextureType, std::string>> texture_types = {
-						{aiTextureType_DIFFUSE, "tex_diffuse"},
-						{aiTextureType_AMBIENT, "tex_ambient"},
-						{aiTextureType_SPECULAR, "tex_specular"},
-						{aiTextureType_REFLECTION, "tex_reflection"},
-						{aiTextureType_SHININESS, "tex_shininess"},
-						{aiTextureType_NORMALS, "tex_normal"},
-						{aiTextureType_HEIGHT, "tex_height"},
-					};
-
-					for (auto tt : texture_types)
+					for (auto tt : cnst_model_texture_types)
 					{
 						for (uint i = 0; i < material->GetTextureCount(tt.first); i++)
 						{
 							aiString str;
 							material->GetTexture(tt.first, i, &str);
-
-							Texture* tex = genTextureFlat(std::string(_directory + '/' + str.C_Str()).c_str());
-							textures.push_back(std::make_pair(tex, std::string(tt.second) + std::to_string(i)));
+							mesh_data.textures.push_back(std::make_pair(directory + '/' + str.C_Str(), std::string(tt.second) + std::to_string(i)));
 						}
 					}
 				}
 
-				//add data to model
-				RenderModelInfo model_map;
-
-				VertexArray* vao = VertexArray::genVertexArray(
-					&vertices[0],
-					sizeof(vertices[0]) * vertices.size(),
-					indices,
-					cnst_vertex_static_layout,
-					GL_STATIC_DRAW);
-				_model->vaos.push_back(vao);
-				model_map.vao = _model->vaos.size() - 1;
-				for (auto t : textures)
-				{
-					_model->textures.push_back(t.first);
-					model_map.textures.push_back(_model->textures.size() - 1);
-					model_map.texture_names.push_back(t.second);
-				}
-				
-				model_map.parent_index = index;
-
-				index = entity._modelMaps.size();
-				entity._modelMaps.push_back(model_map);
+				mesh_data.parent_index = index;
+				index = data.meshes.size();
+				data.meshes.push_back(std::move(mesh_data));
 			}
 			else //if the node is animated
 			{
@@ -189,16 +258,18 @@ namespace sp {
 		// then do the same for each of its children
 		for (uint i = 0; i < node->mNumChildren; i++)
 		{
-			process_node(node->mChildren[i], scene, is_animated, entity, index);
+			process_node(node->mChildren[i], scene, directory, is_animated, data, index);
 		}
 	}
 
 
 	uint RenderCommand::startingTextureSlot = 0;
+	UniformBuffer* RenderCommand::_camera_ubo = nullptr;
 
 
 	void RenderCommand::renderModelEntity(RenderModel* model, uint entity_index, ShaderProgram* sp, glm::mat4 world_transform, bool bind_shader)
 	{
+		sp_profile_function();
 		if (bind_shader)
 			sp->bind();
 		RenderModelEntity& e = model->entities[entity_index];
@@ -217,6 +288,7 @@ namespace sp {
 
 	void RenderCommand::renderModelEntityInstanced(RenderModel* model, uint entity_index, ShaderProgram* sp, std::vector<glm::mat4> world_transforms, bool bind_shader)
 	{
+		sp_profile_function();
 
 		if (bind_shader)
 			sp->bind();
@@ -246,6 +318,7 @@ namespace sp {
 
 	void RenderCommand::renderModel(RenderModel* model, ShaderProgram* sp, glm::mat4 world_transform, bool bind_shader)
 	{
+		sp_profile_function();
 		if (bind_shader)
 			sp->bind();
 
@@ -257,6 +330,7 @@ namespace sp {
 
 	void RenderCommand::renderModelInstanced(RenderModel* model, ShaderProgram* sp, std::vector<glm::mat4> world_transforms, bool bind_shader)
 	{
+		sp_profile_function();
 		if (bind_shader)
 			sp->bind();
 
@@ -268,12 +342,14 @@ namespace sp {
 
 	void RenderCommand::renderVertexArray(VertexArray* vao)
 	{
+		sp_profile_function();
 		if (vao != nullptr)
 			vao->draw(vao->IsInstanced());
 	}
 
 	void RenderCommand::renderVertexArrayInstanced(VertexArray* vao, std::vector<glm::mat4> world_transforms)
 	{
+		sp_profile_function();
 		if (!vao->IsInstanced())
 		{
 			vao->makeInstance(&world_transforms[0], sizeof(glm::mat4) * world_transforms.size(),
@@ -290,6 +366,7 @@ namespace sp {
 
 	void RenderCommand::uploadTextures(ShaderProgram* sp, std::vector<Texture*> textures, uint startingSlot, std::string namePrefix, bool bind_shader)
 	{
+		sp_profile_function();
 		if (bind_shader)
 			sp->bind();
 		for (int i = 0; i < textures.size(); i++)
@@ -308,6 +385,30 @@ namespace sp {
 		}
 	}
 
+	void RenderCommand::submitCamera(Camera& camera)
+	{
+		sp_profile_function();
+		//std140: four column major mat4 and a vec4, no padding needed
+		struct CameraBlock
+		{
+			glm::mat4 view;
+			glm::mat4 projection;
+			glm::mat4 view_projection;
+			glm::vec4 position;
+		};
+		if (_camera_ubo == nullptr)
+			_camera_ubo = new UniformBuffer(sizeof(CameraBlock), cnst_camera_ubo_binding);
+
+		camera.lateLatch();
+		CameraBlock block;
+		block.view = camera.getRenderViewMatrix();
+		block.projection = camera.getProjectionMatrix();
+		block.view_projection = block.projection * block.view;
+		block.position = glm::vec4(camera.getTransform().getPosition(), 1.0f);
+		_camera_ubo->setData(&block, sizeof(CameraBlock));
+		_camera_ubo->bind();
+	}
+
 	void RenderCommand::setClearColor(glm::vec3 color)
 	{
 		glClearColor(color.r, color.g, color.b, 1.0f);
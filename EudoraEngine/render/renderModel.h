@@ -4,6 +4,8 @@
 #include "vertexArray.h"
 #include "texture.h"
 #include "shaderProgram.h"
+#include "uniformBuffer.h"
+#include "../control/camera.h"
 #include <vector>
 #include <list>
 #include <string>
@@ -33,12 +35,32 @@ namespace sp {
 		std::vector<RenderModelEntity> entities = {};
 	};
 
+	//cpu side mesh of a decoded model file, no gl objects yet
+	struct SP_API RenderModelMeshData
+	{
+		int parent_index = -1; // index into RenderModelData::meshes, -1 root
+		std::vector<Vertex_static> vertices = {};
+		std::vector<uint> indices = {};
+		std::vector<std::pair<std::string, std::string>> textures = {}; // file path, uniform name
+	};
+
+	//result of RenderModelLoader::decode_file, handed to upload_decoded on the render thread
+	struct SP_API RenderModelData
+	{
+		std::string name;
+		std::vector<RenderModelMeshData> meshes = {};
+		std::vector<std::pair<std::string, ImageData*>> images = {}; // every texture file the meshes use, decoded
+		~RenderModelData();
+	};
+
 	// class responsible for loading a model file
+	// load_file decodes and uploads in one go on the render thread
+	// for ApplicationLayer::onLoadAsync, call decode_file on the worker and pass the result to
+	// upload_decoded through LoadContext::upload
 	class SP_API RenderModelLoader
 	{
 	private:
 		RenderModel* _model;
-		std::string _directory;
 		static std::unordered_map<std::string, Texture*> _texture_cache;
 
 	public:
@@ -46,21 +68,29 @@ namespace sp {
 		void load_file(std::string name, std::string filepath, bool is_animated = false);
 		void setRenderModelReferance(RenderModel* model) { _model = model; };
 
+		static RenderModelData* decode_file(std::string name, std::string filepath, bool is_animated = false); // any thread, no gl, null on failure
+		void upload_decoded(RenderModelData* data); // render thread, takes ownership of data
 
 		static Texture* genTextureFlat(std::string filepath);
 		static Texture* genTextureCubemap(std::vector<std::string> filepaths);
 
 	private:
-		void process_node(void* node, const void* scene, bool is_animated, RenderModelEntity& entity, int index);
+		static void decode_textures(const void* scene, const std::string& directory, RenderModelData& data); // decodes all material textures in parallel
+		static void process_node(void* node, const void* scene, const std::string& directory, bool is_animated, RenderModelData& data, int index);
 	};
 
 
 	//class to draw models
 	class SP_API RenderCommand
 	{
+	private:
+		static UniformBuffer* _camera_ubo;
 	public:
 		static uint startingTextureSlot;
 		RenderCommand() {};
+		//late latches the camera (if enabled) and writes its matrices to the cnst_glsl_camera_block buffer
+		//call right before the draws that use it
+		static void submitCamera(Camera& camera);
 		static void renderModelEntity(RenderModel* model, uint entity_index, ShaderProgram* sp, glm::mat4 world_transform = glm::mat4(1.0f), bool bind_shader = true);
 		static void renderModelEntityInstanced(RenderModel* model, uint entity_index, ShaderProgram* sp, std::vector<glm::mat4> world_transforms, bool bind_shader = true);
 		static void renderModel(RenderModel* model, ShaderProgram* sp, glm::mat4 world_transform = glm::mat4(1.0f), bool bind_shader = true);
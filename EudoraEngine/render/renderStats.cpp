@@ -0,0 +1,36 @@
+#include "renderStats.h"
+#include <cstdio>
+
+namespace sp {
+
+	RenderStatsData RenderStats::_frames[2];
+	uint RenderStats::_current = 0;
+
+	void RenderStats::endFrame()
+	{
+		_current ^= 1;
+		_frames[_current] = RenderStatsData();
+	}
+
+	bool RenderStats::isCompiledIn()
+	{
+#if !defined(SP_SHIPPING) && !defined(SP_NO_RENDER_STATS)
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	std::string RenderStats::report()
+	{
+		RenderStatsData s = getLastFrame();
+		char line[320];
+		std::snprintf(line, sizeof(line),
+			"draws %llu ( instanced %llu ) triangles %llu instances %llu upload %.1f kb textures %llu shaders %llu uniforms %llu framebuffers %llu",
+			(unsigned long long)s.draw_calls, (unsigned long long)s.instanced_draws, (unsigned long long)s.triangles,
+			(unsigned long long)s.instances, s.upload_bytes / 1024.0, (unsigned long long)s.texture_binds,
+			(unsigned long long)s.shader_binds, (unsigned long long)s.uniform_uploads, (unsigned long long)s.framebuffer_binds);
+		return line;
+	}
+
+};
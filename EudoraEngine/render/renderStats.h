@@ -0,0 +1,45 @@
+#pragma once
+#include "../api.h"
+#include <cstdint>
+#include <string>
+
+//per frame render counters, maintained by the engine's own gl wrappers
+//define SP_SHIPPING (or SP_NO_RENDER_STATS) to compile every counter out
+#if !defined(SP_SHIPPING) && !defined(SP_NO_RENDER_STATS)
+#define sp_render_stat(field, amount) (sp::RenderStats::current().field += (amount))
+#else
+#define sp_render_stat(field, amount) ((void)0)
+#endif
+
+namespace sp {
+
+	struct RenderStatsData
+	{
+		uint64_t draw_calls = 0; // every draw, instanced ones included
+		uint64_t instanced_draws = 0;
+		uint64_t triangles = 0; // summed over all instances
+		uint64_t instances = 0;
+		uint64_t upload_bytes = 0; // vertex, instance and uniform buffer uploads
+		uint64_t texture_binds = 0;
+		uint64_t shader_binds = 0;
+		uint64_t uniform_uploads = 0;
+		uint64_t framebuffer_binds = 0;
+	};
+
+	//render thread only, the counters are plain integers
+	//the frame being recorded is current(), the last finished frame is getLastFrame()
+	class SP_API RenderStats
+	{
+	private:
+		static RenderStatsData _frames[2];
+		static uint _current;
+	public:
+		static RenderStatsData& current() { return _frames[_current]; }
+		static RenderStatsData getLastFrame() { return _frames[_current ^ 1]; } // a copy, the buffer is reused by the next endFrame()
+		static void endFrame(); // called by the display after present, flips the buffers and zeroes the new frame
+
+		static bool isCompiledIn();
+		static std::string report(); // one line summary of the last frame
+	};
+
+};
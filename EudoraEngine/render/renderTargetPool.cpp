@@ -0,0 +1,167 @@
+#include "renderTargetPool.h"
+#include "../console.h"
+#include "../control/logger.h"
+#include <unordered_map>
+#include <vector>
+
+namespace sp {
+
+	struct PooledTarget
+	{
+		RenderTargetKey key;
+		Texture* texture; // null for renderbuffers
+		uint renderbuffer;
+		uint64_t released_frame;
+	};
+
+	uint RenderTargetPool::_retainFrames = 120;
+
+	static std::vector<PooledTarget> s_free;
+	static std::unordered_map<uint, RenderTargetKey> s_liveRenderbuffers;
+	static std::unordered_map<Texture*, RenderTargetKey> s_liveTextures;
+	static uint64_t s_frame = 0;
+	static uint64_t s_allocations = 0;
+
+	static uint64_t keyBytes(const RenderTargetKey& key)
+	{
+		return uint64_t(key.width) * key.height * getTextureFormatSize(key.format) * (key.samples > 0 ? key.samples : 1);
+	}
+
+	static void destroy(PooledTarget& target)
+	{
+		if (target.texture)
+			delete target.texture;
+		else
+			glDeleteRenderbuffers(1, &target.renderbuffer);
+	}
+
+	//most recently released first, it is the likeliest to still be resident
+	static int findFree(const RenderTargetKey& key, bool texture)
+	{
+		for (int i = (int)s_free.size() - 1; i >= 0; i--)
+			if (s_free[i].key == key && (s_free[i].texture != nullptr) == texture)
+				return i;
+		return -1;
+	}
+
+	Texture* RenderTargetPool::acquireTexture(uint width, uint height, TextureFormat format)
+	{
+		RenderTargetKey key = { width, height, format, 1 };
+		Texture* texture = nullptr;
+		int i = findFree(key, true);
+		if (i >= 0)
+		{
+			texture = s_free[i].texture;
+			s_free.erase(s_free.begin() + i);
+		}
+		else
+		{
+			texture = new Texture(width, height, format);
+			s_allocations++;
+		}
+		s_liveTextures[texture] = key;
+		return texture;
+	}
+
+	void RenderTargetPool::releaseTexture(Texture* texture)
+	{
+		if (!texture)
+			return;
+		auto it = s_liveTextures.find(texture);
+		if (it == s_liveTextures.end())
+		{
+			Logger::warn(LogCategory::render, "RenderTargetPool::releaseTexture: texture was not acquired from the pool, ignored");
+			return;
+		}
+		s_free.push_back({ it->second, texture, 0, s_frame });
+		s_liveTextures.erase(it);
+	}
+
+	void RenderTargetPool::detachTexture(Texture* texture)
+	{
+		s_liveTextures.erase(texture);
+	}
+
+	uint RenderTargetPool::acquireRenderbuffer(uint width, uint height, TextureFormat format, uint samples)
+	{
+		RenderTargetKey key = { width, height, format, samples };
+		uint rbo = 0;
+		int i = findFree(key, false);
+		if (i >= 0)
+		{
+			rbo = s_free[i].renderbuffer;
+			s_free.erase(s_free.begin() + i);
+		}
+		else
+		{
+			glGenRenderbuffers(1, &rbo);
+			glBindRenderbuffer(GL_RENDERBUFFER, rbo);
+			if (samples > 1)
+				glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, static_cast<GLenum>(format), width, height);
+			else
+				glRenderbufferStorage(GL_RENDERBUFFER, static_cast<GLenum>(format), width, height);
+			glBindRenderbuffer(GL_RENDERBUFFER, 0);
+			s_allocations++;
+		}
+		s_liveRenderbuffers[rbo] = key;
+		return rbo;
+	}
+
+	void RenderTargetPool::releaseRenderbuffer(uint renderbuffer)
+	{
+		auto it = s_liveRenderbuffers.find(renderbuffer);
+		if (it == s_liveRenderbuffers.end())
+		{
+			Logger::warn(LogCategory::render, "RenderTargetPool::releaseRenderbuffer: renderbuffer {} was not acquired from the pool, ignored", renderbuffer);
+			return;
+		}
+		s_free.push_back({ it->second, nullptr, renderbuffer, s_frame });
+		s_liveRenderbuffers.erase(it);
+	}
+
+	void RenderTargetPool::onFrame()
+	{
+		s_frame++;
+		for (size_t i = 0; i < s_free.size();)
+		{
+			if (s_frame - s_free[i].released_frame > _retainFrames)
+			{
+				destroy(s_free[i]);
+				s_free.erase(s_free.begin() + i);
+			}
+			else
+				i++;
+		}
+	}
+
+	void RenderTargetPool::trim()
+	{
+		for (PooledTarget& target : s_free)
+			destroy(target);
+		s_free.clear();
+	}
+
+	uint64_t RenderTargetPool::getFreeBytes()
+	{
+		uint64_t bytes = 0;
+		for (const PooledTarget& target : s_free)
+			bytes += keyBytes(target.key);
+		return bytes;
+	}
+
+	uint64_t RenderTargetPool::getLiveBytes()
+	{
+		uint64_t bytes = 0;
+		for (auto& it : s_liveTextures)
+			bytes += keyBytes(it.second);
+		for (auto& it : s_liveRenderbuffers)
+			bytes += keyBytes(it.second);
+		return bytes;
+	}
+
+	uint64_t RenderTargetPool::getAllocationCount()
+	{
+		return s_allocations;
+	}
+
+};
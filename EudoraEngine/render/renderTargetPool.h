@@ -0,0 +1,46 @@
+#pragma once
+#include "../api.h"
+#include "texture.h"
+#include <cstdint>
+
+namespace sp {
+
+	struct RenderTargetKey
+	{
+		uint width;
+		uint height;
+		TextureFormat format;
+		uint samples;
+
+		bool operator==(const RenderTargetKey& o) const
+		{
+			return width == o.width && height == o.height && format == o.format && samples == o.samples;
+		}
+	};
+
+	//recycles render target attachments keyed by (size, format, samples)
+	//released attachments wait in a free list and are handed out again before anything new is allocated,
+	//ones unused for the retention window are destroyed by onFrame()
+	//textures use immutable storage, renderbuffers may be multisampled
+	//render thread only
+	class SP_API RenderTargetPool
+	{
+	private:
+		static uint _retainFrames;
+	public:
+		static Texture* acquireTexture(uint width, uint height, TextureFormat format);
+		static void releaseTexture(Texture* texture); // the pointer must not be used afterwards
+		static void detachTexture(Texture* texture); // stop tracking it, the caller now owns and deletes it
+		static uint acquireRenderbuffer(uint width, uint height, TextureFormat format, uint samples = 1);
+		static void releaseRenderbuffer(uint renderbuffer);
+
+		static void onFrame(); // ages the free list, called by the display once per frame
+		static void trim(); // destroys every free attachment now
+		static void setRetainFrames(uint frames) { _retainFrames = frames; }
+
+		static uint64_t getFreeBytes();
+		static uint64_t getLiveBytes();
+		static uint64_t getAllocationCount(); // attachments created since start, a climbing value means the pool is missing
+	};
+
+};
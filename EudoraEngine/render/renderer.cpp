@@ -1,106 +1,420 @@
 #include "renderer.h"
 #include "../console.h"
+#include "renderStats.h"
+#include "renderTargetPool.h"
+#include "../application.h"
+#include "../control/profiler.h"
+#include <algorithm>
 #include "../deps/glad.h"
 
 namespace sp {
 
-	FrameBuffer::FrameBuffer(uint width, uint height, uint resolution, bool retain_texture)
+	static GLenum getDepthAttachment(TextureFormat format)
+	{
+		return format == TextureFormat::depth24_stencil8 ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT;
+	}
+
+	FrameBuffer::FrameBuffer(uint width, uint height, uint resolution, bool retain_texture, TextureFormat format)
 	{
-		_resolution = resolution;
 		_retain_texture = retain_texture;
+		_layout.colors = { format };
+		_rbo = 0;
 		glGenFramebuffers(1, &_fbo);
-		glBindFramebuffer(GL_FRAMEBUFFER, _fbo);
+		attach(width, height, resolution);
+	}
 
-		_texture = new Texture(width * _resolution, height * resolution);
-		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, _texture->getTextureId(), 0);
+	FrameBuffer::FrameBuffer(uint width, uint height, FrameBufferLayout layout, uint resolution)
+	{
+		if (layout.colors.size() > cnst_max_color_attachments)
+			Console::err("too many color attachments", "FrameBuffer constructor");
+		if (!isDepthFormat(layout.depth))
+			Console::err("framebuffer depth attachment needs a depth format", "FrameBuffer constructor");
+		_retain_texture = false;
+		_layout = layout;
+		_rbo = 0;
+		if (layout.samples > 1)
+		{
+			GLint max_samples = 1;
+			glGetIntegerv(GL_MAX_SAMPLES, &max_samples);
+			for (TextureFormat f : layout.colors)
+			{
+				if (!isIntegerFormat(f))
+					continue;
+				GLint max_integer_samples = 1;
+				glGetIntegerv(GL_MAX_INTEGER_SAMPLES, &max_integer_samples);
+				max_samples = std::min(max_samples, max_integer_samples);
+			}
+			_samples = std::max(1u, std::min(layout.samples, (uint)max_samples));
+			_layout.samples = _samples;
+			if (_samples > 1)
+				glGenFramebuffers(1, &_msaa_fbo);
+		}
+		glGenFramebuffers(1, &_fbo);
+		attach(width, height, resolution);
+	}
 
-		glGenRenderbuffers(1, &_rbo);
-		glBindRenderbuffer(GL_RENDERBUFFER, _rbo);
-		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width * _resolution, height * _resolution);
-		glBindRenderbuffer(GL_RENDERBUFFER, 0);
-		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, _rbo);
+	FrameBuffer::~FrameBuffer()
+	{
+		releaseAttachments();
+		for (Texture* texture : _retired_textures)
+			delete texture;
+		glDeleteFramebuffers(1, &_fbo);
+		if (_msaa_fbo)
+			glDeleteFramebuffers(1, &_msaa_fbo);
+	}
+
+	void FrameBuffer::attach(uint width, uint height, uint resolution)
+	{
+		_resolution = resolution;
+		_width = width * resolution;
+		_height = height * resolution;
+
+		glBindFramebuffer(GL_FRAMEBUFFER, _fbo);
+		GLenum buffers[cnst_max_color_attachments];
+		for (uint i = 0; i < _layout.colors.size(); i++)
+		{
+			_textures.push_back(RenderTargetPool::acquireTexture(_width, _height, _layout.colors[i]));
+			glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, _textures[i]->getTextureId(), 0);
+			buffers[i] = GL_COLOR_ATTACHMENT0 + i;
+		}
+		if (_layout.colors.empty())
+		{
+			glDrawBuffer(GL_NONE);
+			glReadBuffer(GL_NONE);
+		}
+		else
+		{
+			glDrawBuffers((GLsizei)_layout.colors.size(), buffers);
+			glReadBuffer(GL_COLOR_ATTACHMENT0);
+		}
+
+		GLenum depth_attachment = getDepthAttachment(_layout.depth);
+		if (_layout.sampleable_depth)
+		{
+			_depth_texture = RenderTargetPool::acquireTexture(_width, _height, _layout.depth);
+			glFramebufferTexture2D(GL_FRAMEBUFFER, depth_attachment, GL_TEXTURE_2D, _depth_texture->getTextureId(), 0);
+		}
+		else if (_samples == 1 || _layout.colors.empty()) // a multisampled target only needs depth while drawing
+		{
+			_rbo = RenderTargetPool::acquireRenderbuffer(_width, _height, _layout.depth);
+			glFramebufferRenderbuffer(GL_FRAMEBUFFER, depth_attachment, GL_RENDERBUFFER, _rbo);
+		}
 
 		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
 		{
-			Console::err("frame buffer is not complete", "frame_buffer constructor failed");
+			Console::err("frame buffer is not complete", "FrameBuffer::attach");
 		}
 
+		if (_samples > 1)
+			attachMultisample();
+
 		glBindFramebuffer(GL_FRAMEBUFFER, 0);
 	}
 
-	FrameBuffer::~FrameBuffer()
+	void FrameBuffer::attachMultisample()
 	{
-		glDeleteFramebuffers(1, &_fbo);
-		glDeleteRenderbuffers(1, &_rbo);
-		if (!_retain_texture)
-			delete _texture;
+		//renderbuffers, the samples never outlive the pass so they are never sampled as textures
+		glBindFramebuffer(GL_FRAMEBUFFER, _msaa_fbo);
+		GLenum buffers[cnst_max_color_attachments];
+		for (uint i = 0; i < _layout.colors.size(); i++)
+		{
+			_msaa_colors.push_back(RenderTargetPool::acquireRenderbuffer(_width, _height, _layout.colors[i], _samples));
+			glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_RENDERBUFFER, _msaa_colors[i]);
+			buffers[i] = GL_COLOR_ATTACHMENT0 + i;
+		}
+		if (_layout.colors.empty())
+		{
+			glDrawBuffer(GL_NONE);
+			glReadBuffer(GL_NONE);
+		}
+		else
+		{
+			glDrawBuffers((GLsizei)_layout.colors.size(), buffers);
+			glReadBuffer(GL_COLOR_ATTACHMENT0);
+		}
+		_msaa_depth = RenderTargetPool::acquireRenderbuffer(_width, _height, _layout.depth, _samples);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, getDepthAttachment(_layout.depth), GL_RENDERBUFFER, _msaa_depth);
+
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		{
+			Console::err("multisampled frame buffer is not complete", "FrameBuffer::attachMultisample");
+		}
+	}
+
+	void FrameBuffer::releaseAttachments()
+	{
+		for (uint i = 0; i < _textures.size(); i++)
+		{
+			//a retained texture is never returned to the pool
+			if (i == 0 && _retain_texture)
+				RenderTargetPool::detachTexture(_textures[i]);
+			else
+				RenderTargetPool::releaseTexture(_textures[i]);
+		}
+		_textures.clear();
+		if (_depth_texture)
+			RenderTargetPool::releaseTexture(_depth_texture);
+		if (_rbo != 0)
+			RenderTargetPool::releaseRenderbuffer(_rbo);
+		for (uint rbo : _msaa_colors)
+			RenderTargetPool::releaseRenderbuffer(rbo);
+		_msaa_colors.clear();
+		if (_msaa_depth != 0)
+			RenderTargetPool::releaseRenderbuffer(_msaa_depth);
+		_depth_texture = nullptr;
+		_rbo = 0;
+		_msaa_depth = 0;
 	}
 
 	void FrameBuffer::bind()
 	{
-		glBindFramebuffer(GL_FRAMEBUFFER, _fbo);
+		if (_resize_pending && Application::getFrameCount() - _pending_frame >= cnst_resize_settle_frames)
+			setDimension(_pending_width, _pending_height, _pending_resolution);
+		glBindFramebuffer(GL_FRAMEBUFFER, getDrawFrameBufferId());
+		sp_render_stat(framebuffer_binds, 1);
 	}
 
 	void FrameBuffer::bindScreen()
 	{
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		Display* display = Application::getMainDisplay();
+		glBindFramebuffer(GL_FRAMEBUFFER, display ? display->getScreenFrameBufferId() : 0);
+		sp_render_stat(framebuffer_binds, 1);
 	}
 
+	void FrameBuffer::setViewport()
+	{
+		glViewport(0, 0, getRenderWidth(), getRenderHeight());
+	}
 
-	void FrameBuffer::setDimension(int width, int height, uint resolution)
+	uint FrameBuffer::getRenderWidth() const
 	{
-		if (!_retain_texture)
-			delete _texture;
+		return std::max(1u, uint(_width * _render_scale + 0.5f));
+	}
 
-		_resolution = resolution;
+	uint FrameBuffer::getRenderHeight() const
+	{
+		return std::max(1u, uint(_height * _render_scale + 0.5f));
+	}
+
+	void FrameBuffer::setRenderScale(float scale)
+	{
+		_render_scale = std::min(std::max(scale, 0.01f), 1.0f);
+	}
+
+	void FrameBuffer::blitToScreen()
+	{
+		Display* display = Application::getMainDisplay();
+		if (!display)
+			return;
+		if (_textures.empty())
+			return;
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, _fbo);
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, display->getScreenFrameBufferId());
+		glBlitFramebuffer(0, 0, getRenderWidth(), getRenderHeight(),
+			0, 0, display->getWidth(), display->getHeight(), GL_COLOR_BUFFER_BIT, GL_LINEAR);
+		bindScreen();
+	}
+
+	void FrameBuffer::resolve()
+	{
+		if (_msaa_fbo == 0)
+			return;
+		sp_profile_function();
+		uint width = getRenderWidth();
+		uint height = getRenderHeight();
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, _msaa_fbo);
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, _fbo);
+		//one blit per attachment, a blit only writes the read buffer into the draw buffers
+		GLenum buffers[cnst_max_color_attachments];
+		for (uint i = 0; i < _msaa_colors.size(); i++)
+		{
+			glReadBuffer(GL_COLOR_ATTACHMENT0 + i);
+			glDrawBuffer(GL_COLOR_ATTACHMENT0 + i);
+			glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+			buffers[i] = GL_COLOR_ATTACHMENT0 + i;
+		}
+		if (_depth_texture)
+		{
+			GLbitfield mask = _layout.depth == TextureFormat::depth24_stencil8 ? GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT : GL_DEPTH_BUFFER_BIT;
+			glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, mask, GL_NEAREST);
+		}
+		if (!_msaa_colors.empty())
+		{
+			glReadBuffer(GL_COLOR_ATTACHMENT0);
+			glDrawBuffers((GLsizei)_msaa_colors.size(), buffers);
+		}
+
+		//the samples are dead now, lets the driver skip writing them back
+		GLenum discard[cnst_max_color_attachments + 1];
+		for (uint i = 0; i < _msaa_colors.size(); i++)
+			discard[i] = GL_COLOR_ATTACHMENT0 + i;
+		discard[_msaa_colors.size()] = getDepthAttachment(_layout.depth);
+		glInvalidateFramebuffer(GL_READ_FRAMEBUFFER, (GLsizei)_msaa_colors.size() + 1, discard);
 
 		glBindFramebuffer(GL_FRAMEBUFFER, _fbo);
-		_texture = new Texture(width * _resolution, height * _resolution);
-		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, _texture->getTextureId(), 0);
-		glBindRenderbuffer(GL_RENDERBUFFER, _rbo);
-		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width * _resolution, height * _resolution);
-		glBindRenderbuffer(GL_RENDERBUFFER, 0);
-		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, _rbo);
+		sp_render_stat(framebuffer_binds, 1);
+	}
 
-		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+
+	void FrameBuffer::setDimension(int width, int height, uint resolution)
+	{
+		_resize_pending = false;
+		if (width * resolution == _width && height * resolution == _height && resolution == _resolution)
+			return;
+		if (_retain_texture && !_textures.empty())
+			_retired_textures.push_back(_textures[0]);
+		releaseAttachments();
+		attach(width, height, resolution);
+	}
+
+	std::vector<Texture*> FrameBuffer::takeRetiredTextures()
+	{
+		std::vector<Texture*> retired;
+		retired.swap(_retired_textures);
+		return retired;
+	}
+
+	void FrameBuffer::requestDimension(int width, int height, uint resolution)
+	{
+		if (!_resize_pending && width * resolution == _width && height * resolution == _height && resolution == _resolution)
+			return;
+		_resize_pending = true;
+		_pending_width = width;
+		_pending_height = height;
+		_pending_resolution = resolution;
+		_pending_frame = Application::getFrameCount();
+	}
+
+
+	GpuTimer::GpuTimer()
+		:_index(0),
+		_time_ms(0.0f)
+	{
+		glGenQueries(cnst_gpu_timer_latency * 2, &_queries[0][0]);
+		for (uint i = 0; i < cnst_gpu_timer_latency; i++)
+			_pending[i] = false;
+	}
+
+	GpuTimer::~GpuTimer()
+	{
+		glDeleteQueries(cnst_gpu_timer_latency * 2, &_queries[0][0]);
+	}
+
+	void GpuTimer::begin()
+	{
+		uint slot = _index % cnst_gpu_timer_latency;
+		if (_pending[slot])
 		{
-			Console::err("frame buffer is not complete", "frame_buffer constructor failed");
+			//oldest pair, normally finished long ago; if not, drop it rather than stall
+			GLint available = 0;
+			glGetQueryObjectiv(_queries[slot][1], GL_QUERY_RESULT_AVAILABLE, &available);
+			if (available)
+			{
+				GLuint64 start = 0, end = 0;
+				glGetQueryObjectui64v(_queries[slot][0], GL_QUERY_RESULT, &start);
+				glGetQueryObjectui64v(_queries[slot][1], GL_QUERY_RESULT, &end);
+				_time_ms = float(double(end - start) / 1000000.0);
+			}
+			_pending[slot] = false;
 		}
+		glQueryCounter(_queries[slot][0], GL_TIMESTAMP);
+	}
 
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	void GpuTimer::end()
+	{
+		uint slot = _index % cnst_gpu_timer_latency;
+		glQueryCounter(_queries[slot][1], GL_TIMESTAMP);
+		_pending[slot] = true;
+		_index++;
 	}
 
 
+	std::vector<RenderInterface*> RenderInterface::_instances = {};
+	bool RenderInterface::_gpu_timing = true;
+
 	RenderInterface::RenderInterface(std::string name, uint width, uint height, uint resolution)
 		: _name(name)
 	{
 		_frame_buffer = new FrameBuffer(width, height, resolution);
 		_previous_pass_renderer = nullptr;
+		_gpu_timer = new GpuTimer();
+		_instances.push_back(this);
+	}
+
+	RenderInterface::RenderInterface(std::string name, uint width, uint height, FrameBufferLayout layout, uint resolution)
+		: _name(name)
+	{
+		_frame_buffer = new FrameBuffer(width, height, layout, resolution);
+		_previous_pass_renderer = nullptr;
+		_gpu_timer = new GpuTimer();
+		_instances.push_back(this);
 	}
 
 	RenderInterface::~RenderInterface()
 	{
+		_instances.erase(std::find(_instances.begin(), _instances.end(), this));
+		delete _gpu_timer;
+		delete _dynamic_resolution;
 		delete _frame_buffer;
 	}
 
 	void RenderInterface::render(bool screen)
 	{
-		if (screen)
+		sp_profile_function();
+		if (_gpu_timing)
+			_gpu_timer->begin();
+		if (_dynamic_resolution)
 		{
-			_frame_buffer->bindScreen();
-			onRender();
+			//this pass's own time, a few frames old like the whole frame time would be
+			float gpu_ms = _gpu_timing ? getGpuTime_ms() : Application::getGpuFrameTime_ms();
+			_frame_buffer->setRenderScale(_dynamic_resolution->update(gpu_ms));
 		}
-		else
+		//an offscreen pass draws over its render area, the caller's viewport is restored afterwards
+		bool offscreen = !screen || _dynamic_resolution || _frame_buffer->isMultisampled();
+		GLint viewport[4];
+		if (offscreen)
 		{
+			glGetIntegerv(GL_VIEWPORT, viewport);
 			_frame_buffer->bind();
+			_frame_buffer->setViewport();
 			onRender();
+			_frame_buffer->resolve();
+			if (screen)
+				_frame_buffer->blitToScreen();
+			else
+				_frame_buffer->bindScreen();
+			glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+		}
+		else
+		{
 			_frame_buffer->bindScreen();
+			onRender();
 		}
+		if (_gpu_timing)
+			_gpu_timer->end();
 	}
 
 	void RenderInterface::resize(uint width, uint height, uint resolution)
 	{
-		_frame_buffer->setDimension(width, height, resolution);
+		_frame_buffer->requestDimension(width, height, resolution);
+	}
+
+	void RenderInterface::enableDynamicResolution(float target_ms, float min_scale, float max_scale)
+	{
+		if (_dynamic_resolution)
+		{
+			_dynamic_resolution->setTarget_ms(target_ms);
+			_dynamic_resolution->setBounds(min_scale, max_scale);
+			return;
+		}
+		_dynamic_resolution = new DynamicResolution(target_ms, min_scale, max_scale);
+	}
+
+	void RenderInterface::disableDynamicResolution()
+	{
+		delete _dynamic_resolution;
+		_dynamic_resolution = nullptr;
+		_frame_buffer->setRenderScale(1.0f);
 	}
 
 	void RenderInterface::renderPipe(bool last)
@@ -126,6 +440,14 @@ namespace sp {
 			render(false);
 	}
 
+	std::map<std::string, float> RenderInterface::getPassTimings()
+	{
+		std::map<std::string, float> timings = {};
+		for (RenderInterface* r : _instances)
+			timings[r->getName()] = r->getGpuTime_ms();
+		return timings;
+	}
+
 	void RenderInterface::pushTexture(std::string name, Texture* tex)
 	{
 		_texture_map[name] = tex;
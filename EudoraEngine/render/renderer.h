@@ -1,6 +1,9 @@
+#pragma once
 #include "../api.h"
 #include "texture.h"
+#include "dynamicResolution.h"
 #include <map>
+#include <vector>
 
 
 namespace sp {
@@ -9,27 +12,106 @@ namespace sp {
 	// framebuffer is like a offscreen canvas for drawing
 	// bind to draw offscreen
 	// call get texture to get results
+	// render scale shrinks the area drawn into without reallocating, setViewport() applies it (bind() never touches the viewport)
+	// attachments come from RenderTargetPool, getTexture() is only valid until the next resize
+	// a retained color texture outlives the framebuffer, the caller deletes it; one replaced by a resize stays owned
+	// by the framebuffer until takeRetiredTextures() hands it over (untaken ones are deleted with the framebuffer)
+	// multisampled framebuffers draw into pooled multisample renderbuffers, resolve() blits them into the textures
+	// and invalidates the samples, so a multisampled pass has to clear at its start
+	const uint cnst_resize_settle_frames = 3; // requestDimension waits this many frames without a new request
+	const uint cnst_max_color_attachments = 8; // guaranteed by gl 4.4
+
+	//attachments of a framebuffer, colors are bound to draw buffers in order
+	//an empty color list gives a depth only target (shadow maps)
+	struct FrameBufferLayout
+	{
+		std::vector<TextureFormat> colors = { TextureFormat::rgba8 };
+		TextureFormat depth = TextureFormat::depth24_stencil8;
+		bool sampleable_depth = false; // depth as a texture instead of a renderbuffer
+		uint samples = 1; // msaa sample count, clamped to what the driver supports
+	};
+
 	class SP_API FrameBuffer
 	{
 	private:
+		uint _width; // allocated size in pixels, resolution included
+		uint _height;
+		float _render_scale = 1.0f;
 		uint _resolution;
 		uint _fbo;
-		uint _rbo;
-		Texture* _texture;
-		bool _retain_texture;
+		uint _rbo; // depth renderbuffer, 0 when depth is sampleable
+		uint _samples = 1;
+		uint _msaa_fbo = 0; // drawn into when multisampled, _fbo then only holds the resolved textures
+		std::vector<uint> _msaa_colors;
+		uint _msaa_depth = 0;
+		std::vector<Texture*> _textures; // one per color attachment
+		Texture* _depth_texture = nullptr;
+		FrameBufferLayout _layout;
+		bool _retain_texture; // applies to color attachment 0
+		std::vector<Texture*> _retired_textures; // retained textures replaced by a resize, not taken yet
+		bool _resize_pending = false;
+		uint _pending_width = 0;
+		uint _pending_height = 0;
+		uint _pending_resolution = 1;
+		uint _pending_frame = 0;
 	public:
-		FrameBuffer(uint width , uint height , uint resolution = 1, bool retain_texture = false); // if retain texture is set to true the texture will not delete even thought the framebuffer is deleted
+		FrameBuffer(uint width , uint height , uint resolution = 1, bool retain_texture = false, TextureFormat format = TextureFormat::rgba8); // if retain texture is set to true the texture will not delete even thought the framebuffer is deleted
+		FrameBuffer(uint width, uint height, FrameBufferLayout layout, uint resolution = 1);
 		~FrameBuffer();
 
 		void bind();
 		void bindScreen();
+		void setViewport(); // viewport to the render area, call after bind() when drawing at a render scale
 
-		uint getFrameBufferId() const { return _fbo; }
-		Texture* getTexture() const { return _texture; }
+		uint getFrameBufferId() const { return _fbo; } // the resolved framebuffer
+		uint getDrawFrameBufferId() const { return _msaa_fbo ? _msaa_fbo : _fbo; }
+		uint getSamples() const { return _samples; }
+		bool isMultisampled() const { return _samples > 1; }
+		Texture* getTexture() const { return _textures.empty() ? nullptr : _textures[0]; }
+		Texture* getTexture(uint attachment) const { return attachment < _textures.size() ? _textures[attachment] : nullptr; }
+		Texture* getDepthTexture() const { return _depth_texture; } // null unless the layout asked for sampleable depth
+		uint getColorAttachmentCount() const { return (uint)_textures.size(); }
+		const FrameBufferLayout& getLayout() const { return _layout; }
 		bool get_is_retaining_texture() const { return _retain_texture; }
+		std::vector<Texture*> takeRetiredTextures(); // retained textures dropped by resizes since the last call, the caller deletes them
 		uint get_resolution() const { return _resolution; }
+		uint getWidth() const { return _width; }
+		uint getHeight() const { return _height; }
+		uint getRenderWidth() const;
+		uint getRenderHeight() const;
+		float getRenderScale() const { return _render_scale; }
 
-		void setDimension(int width, int height, uint resolution = 1);
+		void setDimension(int width, int height, uint resolution = 1); // reattaches now, no-op if the size is unchanged
+		void requestDimension(int width, int height, uint resolution = 1); // applied by bind() once requests stop changing
+		bool isResizePending() const { return _resize_pending; }
+		void setRenderScale(float scale); // (0, 1] of the allocated size, takes effect on the next bind
+		void blitToScreen(); // linear upscale of color attachment 0 onto the display's screen target
+		void resolve(); // multisampled only: samples -> textures, then discards the samples, leaves the resolved framebuffer bound
+
+	private:
+		void attach(uint width, uint height, uint resolution);
+		void releaseAttachments();
+		void attachMultisample();
+	};
+
+	//measures gpu time between begin() and end() with timestamp queries
+	//results are read back cnst_gpu_timer_latency uses later, so the cpu never waits on the gpu
+	//timestamps (not GL_TIME_ELAPSED) are used so timers may nest
+	const uint cnst_gpu_timer_latency = 4;
+	class SP_API GpuTimer
+	{
+	private:
+		uint _queries[cnst_gpu_timer_latency][2];
+		bool _pending[cnst_gpu_timer_latency];
+		uint _index;
+		float _time_ms;
+	public:
+		GpuTimer();
+		~GpuTimer();
+
+		void begin();
+		void end();
+		float getTime_ms() const { return _time_ms; } // latest resolved measurement
 	};
 
 	//parent class of all renderers.
@@ -41,16 +123,24 @@ namespace sp {
 		RenderInterface* _previous_pass_renderer = nullptr;
 		std::map<std::string, Texture*> _texture_map;
 		std::string _name = "base_renderer";
+		GpuTimer* _gpu_timer;
+		DynamicResolution* _dynamic_resolution = nullptr;
+
+		static std::vector<RenderInterface*> _instances;
+		static bool _gpu_timing;
 
 	public:
 		RenderInterface(std::string name, uint width, uint height, uint resolution = 1);
+		RenderInterface(std::string name, uint width, uint height, FrameBufferLayout layout, uint resolution = 1);
 		virtual ~RenderInterface();
 		virtual void onInit() {};
 		virtual void onRender() = 0;
 		virtual void onDestroy() = 0;
 
+		//offscreen (screen false, multisampled or dynamic resolution) the pass draws over its framebuffer's render area,
+		//the caller's viewport is restored afterwards; straight to the screen it keeps the caller's viewport
 		void render(bool screen = true);
-		void resize(uint width, uint height, uint resolution = 4);
+		void resize(uint width, uint height, uint resolution = 1); // deferred until the size settles
 		void renderPipe(bool last = true);
 		void pushTexture(std::string name, Texture* textute);
 		Texture* getTexture(std::string name);
@@ -58,6 +148,19 @@ namespace sp {
 		FrameBuffer* getFrameBuffer() const { return _frame_buffer; }
 		RenderInterface* getPreviousPassRenderer() const { return _previous_pass_renderer; }
 		std::string getName() const { return _name; }
+		float getGpuTime_ms() const { return _gpu_timer->getTime_ms(); }
+		DynamicResolution* getDynamicResolution() const { return _dynamic_resolution; }
+
+		//scale this pass's framebuffer to hold its own gpu time (getGpuTime_ms()) at target_ms, so every pass gets its
+		//own budget; with gpu timing disabled it falls back to Application::getGpuFrameTime_ms()
+		//the framebuffer stays at its allocated size (use resolution for headroom above native), only the viewport shrinks
+		//as a screen pass it renders offscreen and is upscaled to the screen, as an inner pass the next pass
+		//must multiply its uvs by getFrameBuffer()->getRenderScale()
+		void enableDynamicResolution(float target_ms, float min_scale = 0.5f, float max_scale = 1.0f);
+		void disableDynamicResolution();
+
+		static std::map<std::string, float> getPassTimings(); // gpu ms of every live pass, keyed by getName()
+		static void setGpuTiming(bool enable) { _gpu_timing = enable; }
 
 		void setPreviousPassRenderer(RenderInterface* renderer) { _previous_pass_renderer = renderer; };
 		void setName(std::string name) { _name = name; }
@@ -2,6 +2,7 @@
 #include <utility>
 #include "../deps/glm/gtc/type_ptr.hpp"
 #include "../console.h"
+#include "renderStats.h"
 #include <fstream>
 #include <sstream>
 
@@ -118,6 +119,7 @@ namespace sp {
 	void ShaderProgram::bind()
 	{
 		glUseProgram(_program);
+		sp_render_stat(shader_binds, 1);
 	}
 
 	void ShaderProgram::unbind()
@@ -128,41 +130,49 @@ namespace sp {
 	void ShaderProgram::uniform_v3(glm::vec3 v, const char* name)
 	{
 		glUniform3f(getUniformLocation(name), v.x, v.y, v.z);
+		sp_render_stat(uniform_uploads, 1);
 	}
 
 	void ShaderProgram::uniform_v3_vector(std::vector<glm::vec3> vs, const char* name)
 	{
 		glUniform3fv(getUniformLocation(name), vs.size(), (float*)(&vs[0]));
+		sp_render_stat(uniform_uploads, 1);
 	}
 
 	void ShaderProgram::uniform_v4(glm::vec4 v, const char* name)
 	{
 		glUniform4f(getUniformLocation(name), v.x, v.y, v.z, v.w);
+		sp_render_stat(uniform_uploads, 1);
 	}
 
 	void ShaderProgram::uniform_v4_vector(std::vector<glm::vec4> vs, const char* name)
 	{
 		glUniform4fv(getUniformLocation(name), vs.size(), (float*)(&vs[0]));
+		sp_render_stat(uniform_uploads, 1);
 	}
 
 	void ShaderProgram::uniform_m4(glm::mat4 m, const char* name)
 	{
 		glUniformMatrix4fv(getUniformLocation(name), 1, GL_FALSE, glm::value_ptr(m));
+		sp_render_stat(uniform_uploads, 1);
 	}
 
 	void ShaderProgram::uniform_m4_vector(std::vector<glm::mat4> ms, const char* name)
 	{
 		glUniformMatrix4fv(getUniformLocation(name), ms.size(), GL_FALSE, (float*)(&ms[0]));
+		sp_render_stat(uniform_uploads, 1);
 	}
 
 	void ShaderProgram::uniform_f(float f, char* name)
 	{
 		glUniform1f(getUniformLocation(name), f);
+		sp_render_stat(uniform_uploads, 1);
 	}
 
 	void ShaderProgram::uniform_i(int i, char* name)
 	{
 		glUniform1i(getUniformLocation(name), i);
+		sp_render_stat(uniform_uploads, 1);
 	}
 
 	uint ShaderProgram::getUniformLocation(std::string name) const
@@ -18,6 +18,17 @@ namespace sp {
 	const char* const cnst_txt_matrix_projection = "projection_matrix";
 	const char* const cnst_txt_matrix_view = "view_matrix";
 
+	//camera block written by RenderCommand::submitCamera, paste into shaders that want it
+	const uint cnst_camera_ubo_binding = 0;
+	const char* const cnst_glsl_camera_block =
+		"layout(std140, binding = 0) uniform sp_camera\n"
+		"{\n"
+		"	mat4 camera_view;\n"
+		"	mat4 camera_projection;\n"
+		"	mat4 camera_view_projection;\n"
+		"	vec4 camera_position;\n"
+		"};\n";
+
 	const char* const cnst_txt_font_texture = "font_texture";
 	const char* const cnst_txt_font_color = "font_color";
 
@@ -1,5 +1,7 @@
 #include "textCreator.h"
 #include "../console.h"
+#include "../control/logger.h"
+#include "../control/profiler.h"
 #include "../deps/glm/gtc/matrix_transform.hpp"
 #include <ft2build.h>
 #include FT_FREETYPE_H 
@@ -90,29 +92,45 @@ namespace sp {
 			delete _fontAtlas;
 	}
 
+	FontData::~FontData()
+	{
+		for (auto i : glyphs)
+			delete i;
+	}
+
 	uint TextCreator::submitFont(std::string filepath, uint size)
 	{
-		_pixel_size = size;
-		//loading the font
-		SPCharMap _charmap = {};
+		return submitFont(decodeFont(filepath, size));
+	}
+
+	FontData* TextCreator::decodeFont(std::string filepath, uint size)
+	{
+		sp_profile_function();
 		//font loading
 		FT_Library ft;
 		if (FT_Init_FreeType(&ft))
-			Console::err("could not init freetype.");
+		{
+			Logger::warn(LogCategory::render, "could not init freetype");
+			return nullptr;
+		}
 
 		FT_Face face;
 		if (FT_New_Face(ft, filepath.c_str(), 0, &face))
-			Console::err("unable to load font.", filepath);
+		{
+			Logger::warn(LogCategory::render, "unable to load font {}", filepath);
+			FT_Done_FreeType(ft);
+			return nullptr;
+		}
 
-		FT_Set_Pixel_Sizes(face, 0, _pixel_size);
-		glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // Disable byte-alignment restriction
-		std::vector<ImageData*> font_images = {};
+		FontData* font = new FontData();
+		font->pixel_size = size;
+		FT_Set_Pixel_Sizes(face, 0, size);
 		for (GLubyte c = 0; c < 127; c++)
 		{
 			// Load character glyph 
 			if (FT_Load_Char(face, c, FT_LOAD_RENDER ))
 			{
-				Console::err("ERROR::FREETYTPE: Failed to load Glyph", (const char*)c);
+				Logger::warn(LogCategory::render, "failed to load glyph {} of {}", (uint)c, filepath);
 				continue;
 			}
 
@@ -127,31 +145,37 @@ namespace sp {
 
 				img->applyFilterKernal(filterSharp, 3);
 			}
-			font_images.push_back(img);
+			font->glyphs.push_back(img);
 			// store character 
 			s_char_render_info character = {
-				font_images.size() - 1,
+				font->glyphs.size() - 1,
 				glm::ivec2(face->glyph->bitmap.width, face->glyph->bitmap.rows),
 				glm::ivec2(face->glyph->bitmap_left, face->glyph->bitmap_top),
 				face->glyph->advance.x
 			};
-			_charmap.insert(std::pair<GLchar, s_char_render_info>(c, character));
+			font->char_map.insert(std::pair<GLchar, s_char_render_info>(c, character));
 		}
-		SpriteSheet *_font_atlas = new SpriteSheet(font_images);
-
-		//adding data to font map
-		_fontCount++;
-		_fontAtlasMap.insert(std::make_pair(_fontCount, _font_atlas));
-		_fontcharMapMap.insert(std::make_pair(_fontCount, _charmap));
 
 		//memory deallocation
 		FT_Done_Face(face);
 		FT_Done_FreeType(ft);
-		for (auto i : font_images)
-		{
-			delete i;
-		}
+		return font;
+	}
+
+	uint TextCreator::submitFont(FontData* font)
+	{
+		if (font == nullptr)
+			return 0;
+		_pixel_size = font->pixel_size;
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // Disable byte-alignment restriction
+		SpriteSheet *_font_atlas = new SpriteSheet(font->glyphs);
+
+		//adding data to font map
+		_fontCount++;
+		_fontAtlasMap.insert(std::make_pair(_fontCount, _font_atlas));
+		_fontcharMapMap.insert(std::make_pair(_fontCount, font->char_map));
 
+		delete font;
 		return _fontCount;
 	}
 
@@ -187,6 +211,7 @@ namespace sp {
 
 	uint TextCreator::endDocument()
 	{
+		sp_profile_function();
 		_docVao->setVertexBufferData(&text_model[0], sizeof(text_model[0]) * text_model.size(), GL_DYNAMIC_DRAW);
 		_docVao->setIndexBufferVector(indices);
 		_docVao->setVertexBufferLayout({ { 0, sizeof(cdata), 4, 'f' },{ offsetof(cdata,crop),sizeof(cdata),  4, 'f' }, { offsetof(cdata,color),sizeof(cdata),  4, 'f' } });
@@ -195,6 +220,7 @@ namespace sp {
 
 	void TextCreator::drawDocument()
 	{
+		sp_profile_function();
 		// enable alpha blending
 		glEnable(GL_BLEND);
 		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
@@ -67,6 +67,15 @@ namespace sp {
 
 	typedef std::map<GLchar, s_char_render_info> SPCharMap;
 
+	//glyphs rasterized by TextCreator::decodeFont, no gl objects yet
+	struct SP_API FontData
+	{
+		uint pixel_size = 72;
+		std::vector<ImageData*> glyphs = {};
+		SPCharMap char_map = {};
+		~FontData();
+	};
+
 	class SP_API TextCreator {
 	private:
 		ShaderProgram* _docShader;
@@ -101,6 +110,10 @@ namespace sp {
 		~TextCreator();
 
 		uint submitFont(std::string filepath, uint size = 72);
+		//split version of submitFont for ApplicationLayer::onLoadAsync: decode on the worker,
+		//submit the result on the render thread through LoadContext::upload
+		static FontData* decodeFont(std::string filepath, uint size = 72); // any thread, no gl, null on failure
+		uint submitFont(FontData* font); // render thread, takes ownership of font, 0 if font is null
 		SpriteSheet* getFontSpriteSheet(int id) { return _fontAtlasMap[id]; }
 		SPCharMap getFontCharMap(int id) { return _fontcharMapMap[id]; }
 		VertexArray* getDocumentVertexArray() const { return _docVao; }
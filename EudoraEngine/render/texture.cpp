@@ -5,6 +5,9 @@
 #include "../deps/stb_image.h"
 #include "../deps/stb_image_write.h"
 #include "../console.h"
+#include "../control/logger.h"
+#include "renderStats.h"
+#include "../control/jobSystem.h"
 #include <cmath>
 
 
@@ -34,8 +37,12 @@ namespace sp {
 		int offset = (kernalWidth - 1) / 2;
 		byte* buff = (byte*)malloc(buffer_size * sizeof(byte));
 		memcpy(buff, buffer, buffer_size * sizeof(byte));
-		for (int y = 0; y < height - kernalWidth; y++)
-			for (int x = 0; x < width - kernalWidth; x++)
+		int rows = (int)height - kernalWidth;
+		if (rows <= 0) rows = 0;
+		//rows write disjoint output, so they are split across the job system
+		JobSystem::parallelFor(0, rows, 16, [&](uint y_begin, uint y_end) {
+		for (int y = y_begin; y < (int)y_end; y++)
+			for (int x = 0; x < (int)width - kernalWidth; x++)
 			{
 				for (int n = 0; n < nc; n++) {
 
@@ -57,6 +64,7 @@ namespace sp {
 					buff[((y + offset) * width + x + offset) * nc + n] = pixVal;
 				}
 			}
+		});
 
 		delete buffer;
 		buffer = buff;
@@ -191,18 +199,14 @@ namespace sp {
 		ImageData* img = nullptr;
 		int width, height, nrChannels;
 		byte* data = stbi_load(filepath.c_str(), &width, &height, &nrChannels, 4);
-		Console::real((float)nrChannels);
 		if (data)
 		{
 			img = new ImageData(data, width, height, 4);
 			stbi_image_free(data);
 			return img;
 		}
-		else
-		{
-			Console::err("failed to load image for Image", filepath);
-			return nullptr;
-		}
+		//may run on a worker, the caller decides what a missing image means
+		Logger::warn(LogCategory::render, "failed to load image {}: {}", filepath, stbi_failure_reason());
 		return nullptr;
 	}
 
@@ -277,11 +281,32 @@ namespace sp {
 	}
 
 
-	void ImageData::saveImage_png(ImageData* image, std::string path)
+	bool ImageData::saveImage_png(ImageData* image, std::string path)
+	{
+		return stbi_write_png(path.c_str(), image->width, image->height, 4, image->buffer, image->width * image->num_channel);
+	}
+
+
+	uint getTextureFormatSize(TextureFormat format)
 	{
-		stbi_write_png(path.c_str(), image->width, image->height, 4, image->buffer, image->width * image->num_channel);
+		switch (format)
+		{
+		case TextureFormat::rgb8: return 3;
+		case TextureFormat::rgba16f: return 8;
+		case TextureFormat::r32f: return 4;
+		default: return 4;
+		}
 	}
 
+	bool isDepthFormat(TextureFormat format)
+	{
+		return format == TextureFormat::depth24_stencil8 || format == TextureFormat::depth32f;
+	}
+
+	bool isIntegerFormat(TextureFormat format)
+	{
+		return format == TextureFormat::r32ui;
+	}
 
 	//texture class members
 
@@ -289,6 +314,8 @@ namespace sp {
 		:_width(width),
 		_height(height),
 		_type(type),
+		_format(TextureFormat::rgb8),
+		_immutable(false),
 		_texture_id(0),
 		_slot(0)
 	{
@@ -306,6 +333,25 @@ namespace sp {
 		}
 	}
 
+	Texture::Texture(int width, int height, TextureFormat format)
+		:_width(width),
+		_height(height),
+		_type(TextureType::flat),
+		_format(format),
+		_immutable(true),
+		_texture_id(0),
+		_slot(0)
+	{
+		glGenTextures(1, &_texture_id);
+		glBindTexture(GL_TEXTURE_2D, _texture_id);
+		glTexStorage2D(GL_TEXTURE_2D, 1, static_cast<GLenum>(format), _width, _height);
+		GLint filter = isDepthFormat(format) || isIntegerFormat(format) ? GL_NEAREST : GL_LINEAR;
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+	}
+
 	Texture::~Texture()
 	{
 		glDeleteTextures(1, &_texture_id);
@@ -314,7 +360,7 @@ namespace sp {
 	void Texture::bind()
 	{
 		glBindTexture(static_cast<GLenum>(_type), _texture_id);
-
+		sp_render_stat(texture_binds, 1);
 	}
 
 	void Texture::bind(ShaderProgram* sp, int slot, const char* name)
@@ -323,6 +369,8 @@ namespace sp {
 		glBindTexture(static_cast<GLenum>(_type), _texture_id);
 		uint location = glGetUniformLocation(sp->get_program(), name);
 		glUniform1i(location, slot);
+		sp_render_stat(texture_binds, 1);
+		sp_render_stat(uniform_uploads, 1);
 		_slot = slot;
 	}
 
@@ -348,6 +396,11 @@ namespace sp {
 
 	void Texture::setBufferData(void* data, int width, int height, uint storage_type, uint data_type)
 	{
+		if (_immutable)
+		{
+			Logger::warn(LogCategory::render, "Texture::setBufferData: immutable texture storage cannot be respecified, ignored");
+			return;
+		}
 		if (_type == TextureType::flat)
 		{
 			glBindTexture(static_cast<GLenum>(_type), _texture_id);
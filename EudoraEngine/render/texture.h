@@ -23,12 +23,12 @@ namespace sp {
 		void appDistanceTransform1D();
 		void rotateRight();
 		void rotateLeft();
-		static ImageData* genImage(std::string filepath);
+		static ImageData* genImage(std::string filepath); // thread safe, null (and a warning) on failure
 		static std::vector<ImageData*>genImageVector(std::string filepath, int num_colums, int num_rows);
 		static void flipImageX(ImageData* img);
 		static void flipImageY(ImageData* img);
 
-		static void saveImage_png(ImageData* image, std::string path);
+		static bool saveImage_png(ImageData* image, std::string path);
 
 	};
 
@@ -39,6 +39,25 @@ namespace sp {
 		cubemap = GL_TEXTURE_CUBE_MAP
 	};
 
+	//sized internal formats for render targets
+	enum class TextureFormat
+	{
+		rgb8 = GL_RGB8,
+		rgba8 = GL_RGBA8,
+		rgba16f = GL_RGBA16F,
+		rgb10_a2 = GL_RGB10_A2,
+		r11g11b10f = GL_R11F_G11F_B10F,
+		rg16f = GL_RG16F,
+		r32f = GL_R32F,
+		r32ui = GL_R32UI,
+		depth24_stencil8 = GL_DEPTH24_STENCIL8,
+		depth32f = GL_DEPTH_COMPONENT32F
+	};
+
+	uint SP_API getTextureFormatSize(TextureFormat format); // bytes per pixel
+	bool SP_API isDepthFormat(TextureFormat format);
+	bool SP_API isIntegerFormat(TextureFormat format); // sampled with usampler, never filtered
+
 	//def: class responsible for handling textures
 	class SP_API Texture 
 	{
@@ -46,10 +65,13 @@ namespace sp {
 		int _width;
 		int _height;
 		TextureType _type;
+		TextureFormat _format;
+		bool _immutable; // storage from glTexStorage2D, size and format are fixed
 		uint _texture_id;
 		uint _slot;
 	public:
 		Texture(int width, int height, TextureType type = TextureType::flat);
+		Texture(int width, int height, TextureFormat format); // immutable flat storage, single level
 		~Texture();
 
 		void bind();
@@ -58,6 +80,8 @@ namespace sp {
 
 		uint getTextureId() const { return _texture_id; }
 		TextureType getTextureType() const { return _type; }
+		TextureFormat getFormat() const { return _format; }
+		bool isImmutable() const { return _immutable; }
 		int getWidth() const { return _width; }
 		int getHeight() const { return _height; }
 		std::vector<byte> getPixelVector_rgb();
@@ -0,0 +1,41 @@
+#include "uniformBuffer.h"
+#include "../console.h"
+#include "renderStats.h"
+
+namespace sp {
+
+	UniformBuffer::UniformBuffer(uint size_in_bytes, uint binding, uint update_mode)
+		:_size(size_in_bytes),
+		_binding(binding)
+	{
+		glGenBuffers(1, &_ubo);
+		glBindBuffer(GL_UNIFORM_BUFFER, _ubo);
+		glBufferData(GL_UNIFORM_BUFFER, _size, nullptr, update_mode);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		bind();
+	}
+
+	UniformBuffer::~UniformBuffer()
+	{
+		glDeleteBuffers(1, &_ubo);
+	}
+
+	void UniformBuffer::setData(const void* data, uint size_in_bytes, uint offset)
+	{
+		if (offset + size_in_bytes > _size)
+		{
+			Console::err("uniform buffer overflow", "UniformBuffer::setData");
+			return;
+		}
+		glBindBuffer(GL_UNIFORM_BUFFER, _ubo);
+		glBufferSubData(GL_UNIFORM_BUFFER, offset, size_in_bytes, data);
+		sp_render_stat(upload_bytes, size_in_bytes);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	}
+
+	void UniformBuffer::bind()
+	{
+		glBindBufferBase(GL_UNIFORM_BUFFER, _binding, _ubo);
+	}
+
+};
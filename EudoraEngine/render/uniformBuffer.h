@@ -0,0 +1,27 @@
+#pragma once
+#include "../api.h"
+#include "../deps/glad.h"
+
+namespace sp {
+
+	//opengl uniform buffer bound to a fixed binding point
+	//layout of the data must follow std140 on the glsl side
+	class SP_API UniformBuffer
+	{
+	private:
+		uint _ubo;
+		uint _size;
+		uint _binding;
+	public:
+		UniformBuffer(uint size_in_bytes, uint binding, uint update_mode = GL_DYNAMIC_DRAW);
+		~UniformBuffer();
+
+		void setData(const void* data, uint size_in_bytes, uint offset = 0);
+		void bind(); // (re)attaches the buffer to its binding point
+
+		uint getId() const { return _ubo; }
+		uint getSize() const { return _size; }
+		uint getBinding() const { return _binding; }
+	};
+
+};
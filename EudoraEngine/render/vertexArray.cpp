@@ -1,4 +1,5 @@
 #include "vertexArray.h"
+#include "renderStats.h"
 
 namespace sp {
 
@@ -53,12 +54,14 @@ namespace sp {
 	{
 		glBindBuffer(GL_ARRAY_BUFFER, _vbo);
 		glBufferData(GL_ARRAY_BUFFER, size_in_bytes, data, update_mode);
+		sp_render_stat(upload_bytes, size_in_bytes);
 	}
 
 	void VertexArray::setVertexBufferSubdata(const void* data, uint size_in_bytes, uint offset)
 	{
 		glBindBuffer(GL_ARRAY_BUFFER, _vbo);
 		glBufferSubData(GL_ARRAY_BUFFER, offset, size_in_bytes, data);
+		sp_render_stat(upload_bytes, size_in_bytes);
 	}
 
 	void VertexArray::setVertexBufferLayout(std::vector<VertexBufferLayout> layout)
@@ -135,14 +138,37 @@ namespace sp {
 		glBindVertexArray(0);
 	}
 
+	//triangles produced by count indices of the given draw type
+	static uint64_t triangleCount(VertexDrawType type, uint count)
+	{
+		switch (type)
+		{
+		case VertexDrawType::triangle: return count / 3;
+		case VertexDrawType::triangle_strip: return count > 2 ? count - 2 : 0;
+		case VertexDrawType::quad: return count / 4 * 2;
+		default: return 0;
+		}
+	}
+
 	void VertexArray::draw(bool multiple)
 	{
 
 		glBindVertexArray(_vao);
 		if (_vboi == 0)
+		{
 			glDrawElements(static_cast<GLenum>(_drawType), _indexCount, GL_UNSIGNED_INT, 0);
+			sp_render_stat(draw_calls, 1);
+			sp_render_stat(instances, 1);
+			sp_render_stat(triangles, triangleCount(_drawType, _indexCount));
+		}
 		else if (multiple)
+		{
 			glDrawElementsInstanced(static_cast<GLenum>(_drawType), _indexCount, GL_UNSIGNED_INT, 0, _instanceCount);
+			sp_render_stat(draw_calls, 1);
+			sp_render_stat(instanced_draws, 1);
+			sp_render_stat(instances, _instanceCount);
+			sp_render_stat(triangles, triangleCount(_drawType, _indexCount) * _instanceCount);
+		}
 
 	}
 
@@ -155,6 +181,7 @@ namespace sp {
 			glGenBuffers(1, &_vboi);
 			glBindBuffer(GL_ARRAY_BUFFER, _vboi);
 			glBufferData(GL_ARRAY_BUFFER, size_in_bytes, instance_data, GL_DYNAMIC_DRAW);
+			sp_render_stat(upload_bytes, size_in_bytes);
 
 			int i;
 			for (i = 0; i < layout.size(); i++)
@@ -175,6 +202,7 @@ namespace sp {
 			glBufferData(GL_ARRAY_BUFFER, size_in_bytes, instance_data, GL_DYNAMIC_DRAW);
 		else
 			glBufferSubData(GL_ARRAY_BUFFER, 0, size_in_bytes, instance_data);
+		sp_render_stat(upload_bytes, size_in_bytes);
 		_instanceCount = count;
 	}
 